@@ -24,6 +24,17 @@ typedef Port_t *Portst_t;	//!<A pointer to the shared type representing a *port*
 typedef void CPPDeleter(void *cpp_obj);
 typedef CPPDeleter *CPPDeleterPtr;
 
+//! @name Range of the preallocated small integers shared by Lamb::mk_integer().
+//!@{
+#ifndef LL_SMALL_INT_MIN
+#define LL_SMALL_INT_MIN (-128)
+#endif
+#ifndef LL_SMALL_INT_MAX
+#define LL_SMALL_INT_MAX 1023
+#endif
+static_assert(LL_SMALL_INT_MAX >= LL_SMALL_INT_MIN, "LL_SMALL_INT_MAX must be >= LL_SMALL_INT_MIN\n");
+//!@}
+
 class Cell;		//forward
 typedef Cell *Sexpr_t;	//!<A symbolic expression is a pointer to a cell.
 
@@ -699,7 +710,7 @@ public:
 
   Sexpr_t gensym(Sexpr_t env_exec);	//!<Produce a new unique symbol.
   
-  void  gc_root_push(Sexpr_t p);	//!<Preserve the cell given from GC, until popped.
+  void  gc_root_push(Sexpr_t p);	//!<Preserve the cell given from GC, until popped.  See also LambRootScope.
   void  gc_root_pop(Int_t n=1);		//!<Release the preserved cells for normal GC processing.
   //!@}
   
@@ -866,14 +877,34 @@ public:
     Note that other types may also hold immediate values, but are "less simple" because they are C++ subtypes that are variations on the *Lisp*-declared types.
   */
   //!@{
-  Sexpr_t mk_bool(Bool_t b, Sexpr_t env_exec)				{ return tcons(Cell::T_PAIR, NIL, NIL, env_exec)->set(b);  }
-  Sexpr_t mk_character(Char_t ch, Sexpr_t env_exec)			{ return tcons(Cell::T_PAIR, NIL, NIL, env_exec)->set(ch); }
-  Sexpr_t mk_integer(Int_t i, Sexpr_t env_exec)				{ return tcons(Cell::T_PAIR, NIL, NIL, env_exec)->set(i);  }
+  Sexpr_t mk_bool(Bool_t b, Sexpr_t env_exec)				{ return b ? HASHT : HASHF; }	//the canonical singletons, no GC pressure
+  Sexpr_t mk_character(Char_t ch, Sexpr_t env_exec) {
+    if (this == _small_int_owner) return _small_chars[(unsigned char) ch];	//preallocated, no GC pressure
+    return tcons(Cell::T_PAIR, NIL, NIL, env_exec)->set(ch);
+  }
+  Sexpr_t mk_integer(Int_t i, Sexpr_t env_exec) {
+    if ((i >= small_int_min) && (i <= small_int_max) && (this == _small_int_owner)) return _small_ints[i - small_int_min];	//preallocated, no GC pressure
+    return tcons(Cell::T_PAIR, NIL, NIL, env_exec)->set(i);
+  }
   Sexpr_t mk_real(Real_t r, Sexpr_t env_exec)				{ return tcons(Cell::T_PAIR, NIL, NIL, env_exec)->set(r);  }
 
   Sexpr_t mk_number(Charst_t str, Sexpr_t env_exec);
   Sexpr_t mk_sharp_const(Charst_t name, Sexpr_t env_exec);
   //!@}
+
+  /*! @name Preallocated small integers and characters
+
+    Counters, pin numbers, PWM duties and loop indices are overwhelmingly small integers, and each one used to cost a fresh cell.
+    The integers in [small_int_min, small_int_max] are allocated once and shared, so mk_integer() for them does not allocate at all.
+    All 256 characters are shared the same way, and mk_bool() always returns #t or #f, so string scanning and predicates do not allocate either.
+    The shared cells are allocated statically, outside the cell blocks like NIL and #t, so the collector never frees them.
+    Until small_ints_install() has run (and for any other Lamb instance) mk_integer() and mk_character() allocate as before.
+  */
+  //!@{
+  static const Int_t small_int_min = LL_SMALL_INT_MIN;	//!<Smallest preallocated integer.
+  static const Int_t small_int_max = LL_SMALL_INT_MAX;	//!<Largest preallocated integer.
+  void small_ints_install(Sexpr_t env_target, Sexpr_t env_exec);	//!<Set up the shared small integers and characters and start using them.
+  //!@}
   
   /*! \name Makers for heap storage types
 
@@ -911,6 +942,7 @@ public:
   Sexpr_t mk_bytevector(Int_t k, Sexpr_t env_exec);			//!<Simplest heap allocation with no initialization.
   Sexpr_t mk_bytevector(Int_t k, Bytest_t src, Sexpr_t env_exec);	//!<Heap allocation with initialization.
   Sexpr_t mk_bytevector(Int_t k, Int_t fill, Sexpr_t env_exec);		//!<Heap allocation with initialization.
+  Sexpr_t mk_bytevector_counted(Int_t k, Int_t fill, Sexpr_t env_exec);	//!<Heap allocation whose payload is counted by LambExternal until it is freed.
 
   //!Injection of externally allocated memory, which will not be freed at GC time.
   Sexpr_t mk_bytevector_ext(Int_t k, Bytest_t ext, Sexpr_t env_exec)	{ return tcons(Cell::T_BVEC_EXT, (Word_t) k, (Word_t) ext, env_exec); }  
@@ -936,6 +968,7 @@ public:
   Sexpr_t mk_Mop3_procst_t(Mop3st_t f, Sexpr_t env_exec)		{ return tcons(Cell::T_MOP3_PROC,  (Word_t) NIL, (Word_t) f, env_exec);  }
   Sexpr_t mk_Mop3_nprocst_t(Mop3st_t f, Sexpr_t env_exec)		{ return tcons(Cell::T_MOP3_NPROC, (Word_t) NIL, (Word_t) f, env_exec); }
   Sexpr_t mk_cppobj(void *obj, CPPDeleterPtr deleter, Sexpr_t env_exec)	{ return tcons(Cell::T_CPP_HEAP,   (Word_t) deleter, (Word_t) obj, env_exec); }
+  Sexpr_t mk_cppobj(void *obj, CPPDeleterPtr deleter, Word_t ext_bytes, Sexpr_t env_exec);	//!<As above, with ext_bytes of native memory held by obj counted by LambExternal.
   //!@}
 
   /*! \name Makers for pair types.
@@ -980,6 +1013,16 @@ private:
 
   LambMemoryManager *mem;
 
+  friend class LambHeapSnapshot;
+  friend class LambWeak;
+  friend class LambHeapPolicy;
+  friend class LambCellHandle;
+  friend class LambExternal;
+
+  static Lamb *_small_int_owner;						//!<The Lamb that uses the shared small integers.
+  static Sexpr_t _small_ints[LL_SMALL_INT_MAX - LL_SMALL_INT_MIN + 1];	//!<The shared small integers.
+  static Sexpr_t _small_chars[256];					//!<The shared characters, indexed by unsigned value.
+
   bool _debug_in_progress;
   Int_t _verbosity;
   
@@ -1087,4 +1130,37 @@ inline Sexpr_t Lamb::cdr(Sexpr_t c)	{
   throw mk_syserror("%s Bad type %s", me, c->dump().c_str());
 }
 
+/*! \class LambRootScope
+
+  Scope guard for the GC roots of native code.
+  Each cell passed to protect() is kept from GC until the scope ends, when all of them are popped at once.
+  The pop also happens when an error is thrown through the scope; with bare gc_root_push()/gc_root_pop() such roots were never released.
+*/
+class LambRootScope {
+public:
+  LambRootScope(Lamb &l) : lamb(l), n(0)	{}
+  ~LambRootScope()				{ release(); }
+
+  //!Keep *p* from GC until the end of the scope, and return it.
+  Sexpr_t protect(Sexpr_t p) {
+    lamb.gc_root_push(p);
+    n++;
+    return p;
+  }
+
+  //!Release the cells protected so far, before the end of the scope.
+  void release() {
+    if (!n) return;
+    lamb.gc_root_pop(n);
+    n = 0;
+  }
+
+private:
+  Lamb &lamb;
+  Int_t n;
+
+  LambRootScope(const LambRootScope &) = delete;
+  LambRootScope &operator=(const LambRootScope &) = delete;
+};
+
 #endif
@@ -0,0 +1,817 @@
+#ifndef LL_GC_H
+#define LL_GC_H
+
+#include "LambLisp.h"
+#include <string.h>
+
+/*! @file
+  Heap tools layered over the LambLisp memory manager.
+
+  The collector itself is part of the Lamb VM library, and its per-cell GC flags belong to it.
+  These tools keep their own state in side tables, so they can inspect the heap without disturbing a collection in progress.
+*/
+
+/*! \class LambMarkBitmap
+
+  A sparse side-table of mark bits, one bit per machine word of address space, allocated a page at a time.
+  Cells are word-aligned, so each cell maps to a unique bit; statically allocated cells (NIL, HASHT...) are handled like any other.
+  Pages are found through a small open-addressed hash table, with the most recent page cached because traversals have strong locality.
+  Counting and enumeration run a 64-bit word at a time (popcount / count-trailing-zeros), skipping unmarked regions wholesale.
+*/
+class LambMarkBitmap {
+public:
+
+  LambMarkBitmap()	{ pages = 0;  Npages = Nslots = 0;  last = 0;  grow(); }
+  ~LambMarkBitmap()	{ delete[] pages; }
+
+  //!Return true if the cell was already marked, then mark it.
+  Bool_t test_and_set(Sexpr_t c) {
+    Word_t w       = ((Word_t) c) / sizeof(Word_t);
+    Page *pg       = find((w >> page_shift) + 1, true);
+    uint64_t &bits = pg->bits[(w & page_mask) >> 6];
+    uint64_t bit   = ((uint64_t) 1) << (w & 63);
+    if (bits & bit) return true;
+    bits |= bit;
+    return false;
+  }
+
+  //!Return true if the cell is marked.
+  Bool_t test(Sexpr_t c) {
+    Word_t w = ((Word_t) c) / sizeof(Word_t);
+    Page *pg = find((w >> page_shift) + 1, false);
+    return pg && (pg->bits[(w & page_mask) >> 6] & (((uint64_t) 1) << (w & 63)));
+  }
+
+  //!Return true if the cell was marked, then unmark it.
+  Bool_t test_and_clear(Sexpr_t c) {
+    Word_t w = ((Word_t) c) / sizeof(Word_t);
+    Page *pg = find((w >> page_shift) + 1, false);
+    if (!pg) return false;
+    uint64_t &bits = pg->bits[(w & page_mask) >> 6];
+    uint64_t bit   = ((uint64_t) 1) << (w & 63);
+    if (!(bits & bit)) return false;
+    bits &= ~bit;
+    return true;
+  }
+
+  //!Unmark everything, keeping the pages allocated for reuse.
+  void clear()		{ for (Int_t i=0; i<Nslots; i++) if (pages[i].key) memset(pages[i].bits, 0, sizeof(pages[i].bits)); }
+
+  //!Return the number of marked cells.
+  Int_t count() {
+    Int_t n = 0;
+    for (Int_t i=0; i<Nslots; i++)
+      if (pages[i].key) for (int j=0; j<Nbitwords; j++) n += __builtin_popcountll(pages[i].bits[j]);
+    return n;
+  }
+
+  //!Call f(Sexpr_t) on every marked cell, in no particular order.
+  template <typename F> void for_each(F f) {
+    for (Int_t i=0; i<Nslots; i++) {
+      if (!pages[i].key) continue;
+      Word_t base = (pages[i].key - 1) << page_shift;
+      for (int j=0; j<Nbitwords; j++) {
+	uint64_t bits = pages[i].bits[j];
+	while (bits) {
+	  int b = __builtin_ctzll(bits);
+	  bits &= bits - 1;
+	  f((Sexpr_t) ((base + (j << 6) + b) * sizeof(Word_t)));
+	}
+      }
+    }
+  }
+
+  Int_t bytes()		{ return Nslots * sizeof(Page); }	//!<Return the space used by the side table.
+
+private:
+  static const int page_shift = 9;				//512 words per page
+  static const Word_t page_mask = (1 << page_shift) - 1;
+  static const int Nbitwords = (1 << page_shift) / 64;
+
+  struct Page {
+    Word_t key;			//page number + 1, 0 if slot unused
+    uint64_t bits[Nbitwords];
+  };
+
+  Page *pages;
+  Int_t Npages;
+  Int_t Nslots;
+  Page *last;
+
+  Page *find(Word_t key, Bool_t create) {
+    if (last && (last->key == key)) return last;
+    Word_t mask = Nslots - 1;
+    for (Word_t ix = (key * 2654435761u) & mask; ; ix = (ix + 1) & mask) {
+      Page *pg = &pages[ix];
+      if (pg->key == key) return last = pg;
+      if (pg->key) continue;
+      if (!create) return 0;
+      if (2 * (Npages + 1) > Nslots) { grow();  return find(key, create); }
+      Npages++;
+      pg->key = key;
+      return last = pg;
+    }
+  }
+
+  void grow() {
+    Page *old   = pages;
+    Int_t Nold  = Nslots;
+    Nslots      = Nold ? 2 * Nold : 64;
+    pages       = new Page[Nslots];
+    memset(pages, 0, Nslots * sizeof(Page));
+    Npages      = 0;
+    last        = 0;
+    for (Int_t i=0; i<Nold; i++) {
+      if (!old[i].key) continue;
+      Page *pg = find(old[i].key, true);
+      memcpy(pg->bits, old[i].bits, sizeof(pg->bits));
+    }
+    delete[] old;
+  }
+};
+
+/*! \class LambCellHandle
+
+  32-bit references to cells, numbered as LambMemoryManager::sexpr_to_indices() numbers them: block * cells per block + index in the block.
+  The layout of a Cell is fixed by the VM library, so car and cdr remain full pointers;
+  handles halve the references kept in the tools' own tables instead, such as the LambHeapWalker stack.
+  encode() is inline and tries the block of the previous cell first, so runs of neighbouring cells cost one range check each.
+  Cells outside the blocks (NIL, #t, #f, the expops) have no handle; they are never collected.
+  The block table is read from the memory manager only on LL_GC_WRAP builds, where its layout is known;
+  elsewhere bind() finds no blocks, so no cell has a handle and permanent() is true of every cell.
+*/
+class LambCellHandle {
+public:
+  typedef uint32_t Handle_t;
+  static const Handle_t none = 0xffffffff;
+  static const Int_t cells_per_block = 8192;
+
+  static void bind(Lamb &lamb);	//!<Read the block table of this VM's memory manager.
+
+  //!Return the handle of a cell, or *none*.
+  static Handle_t encode(Sexpr_t c) {
+    if (in_block(c, last)) return last * cells_per_block + (c - table[last]);
+    for (Int_t b=0; b<*Nblocks; b++) if (in_block(c, b)) { last = b;  return b * cells_per_block + (c - table[b]); }
+    return none;
+  }
+
+  static Sexpr_t decode(Handle_t h)	{ return table[h / cells_per_block] + (h % cells_per_block); }	//!<Return the cell of a valid handle.
+  static Bool_t permanent(Sexpr_t c)	{ return encode(c) == none; }					//!<True for cells outside the blocks.
+  static Int_t blocks()			{ return *Nblocks; }						//!<Number of cell blocks.
+  static Sexpr_t block(Int_t b)		{ return table[b]; }						//!<First cell of block b.
+
+private:
+  static Sexpr_t *table;	//!<LambMemoryManager's block table.
+  static Int_t *Nblocks;
+  static Int_t last;
+
+  static Bool_t in_block(Sexpr_t c, Int_t b)	{ return (b < *Nblocks) && (c >= table[b]) && (c < table[b] + cells_per_block); }
+};
+
+/*! \class LambHeapWalker
+
+  Traverse the cells reachable from a set of roots, marking them in a side-table bitmap.
+  The traversal uses an explicit stack, so deep lists and environments cannot overflow the C++ stack.
+
+  The walker sees the VM roots available through the public Lamb interface (oblist, environments, ports, LAMB_INPUT/OUTPUT).
+  Temporaries protected only by gc_root_push() inside a running native operator are not visible, so walk from the top level of a *mop3*.
+  The walker does not allocate cells, so it never triggers a collection while it runs.
+*/
+class LambHeapWalker {
+public:
+
+  LambHeapWalker(Lamb &lamb) : lamb(lamb)	{ stack = 0;  sp = cap = 0;  far = 0;  Nfar = far_cap = 0;  LambCellHandle::bind(lamb); }
+  ~LambHeapWalker()				{ delete[] stack;  delete[] far; }
+
+  void add_root(Sexpr_t c)	{ if (c && !marks.test_and_set(c)) push(c); }	//!<Add a root to the next walk.
+  void add_vm_roots();		//!<Add the roots known to the Lamb VM.
+  Int_t walk(void (*visit)(Sexpr_t c, void *arg) = 0, void *arg = 0);	//!<Mark everything reachable from the roots added so far, calling visit() on each cell newly marked, and return their number.
+
+  LambMarkBitmap marks;		//!<The cells reached so far.
+
+private:
+  Lamb &lamb;
+  LambCellHandle::Handle_t *stack;	//!<Cells to visit, as handles.
+  Int_t sp;
+  Int_t cap;
+  Sexpr_t *far;				//!<Cells to visit that have no handle: the static cells, or every cell where the block table is unknown.
+  Int_t Nfar;
+  Int_t far_cap;
+
+  void push(Sexpr_t c) {
+    LambCellHandle::Handle_t h = LambCellHandle::encode(c);
+    if (h == LambCellHandle::none) {
+      if (Nfar == far_cap) {
+	Int_t ncap = far_cap ? 2 * far_cap : 64;
+	Sexpr_t *nf = new Sexpr_t[ncap];
+	if (Nfar) memcpy(nf, far, Nfar * sizeof(*nf));
+	delete[] far;
+	far     = nf;
+	far_cap = ncap;
+      }
+      far[Nfar++] = c;
+      return;
+    }
+    if (sp == cap) {
+      Int_t ncap = cap ? 2 * cap : 1024;
+      LambCellHandle::Handle_t *ns = new LambCellHandle::Handle_t[ncap];
+      if (sp) memcpy(ns, stack, sp * sizeof(*ns));
+      delete[] stack;
+      stack = ns;
+      cap   = ncap;
+    }
+    stack[sp++] = h;
+  }
+
+  Sexpr_t pop()	{ return Nfar ? far[--Nfar] : LambCellHandle::decode(stack[--sp]); }
+};
+
+/*! \class LambHeapSnapshot
+
+  Snapshot of the cells reachable from the VM roots, to find what holds memory live.
+  write() records every reachable cell by its index in the cell blocks (as LambMemoryManager::sexpr_to_indices() numbers them),
+  with its type, its size including its heap payload, and the indices of the cells it refers to.
+  The singletons outside the cell blocks (NIL, #t, #f ...) refer to nothing and are left out.
+  The roots are named: the oblist, the environments, the ports and, on LL_GC_WRAP builds, each entry of the VM root stack.
+
+  analyze() reads a snapshot, taken on this unit or copied from another, and computes the dominator tree of the reference graph.
+  The cells dominated by a cell are the ones it retains: they would all become garbage without it.
+  The result is the largest retainers, each with its retention path, the chain of dominators from a root down to it.
+
+  The file is binary, in the byte order of the unit that wrote it:
+  - header: "LLHS", then version, number of roots, number of cells and number of references as 32-bit words;
+  - each root: cell index, name length, then the name;
+  - each cell: cell index, type, bytes, number of references, then the references, all 32-bit.
+*/
+class LambHeapSnapshot {
+public:
+  static const Int_t version = 1;
+
+  //!One line of the analysis.
+  struct Retainer {
+    Int_t id;		//!<Cell index.
+    Int_t typ;
+    Word_t retained;	//!<Bytes of the cells dominated, including this one.
+    Int_t Ncells;	//!<Number of those cells.
+    char path[160];	//!<Retention path, root first.
+  };
+
+  static Int_t write(Lamb &lamb, const char *path);			//!<Write a snapshot and return the number of cells in it, or -1 if the file could not be opened.
+  static Int_t analyze(const char *path, Retainer *top, Int_t Nmax);	//!<Fill *top* with the largest retainers, largest first, and return their number, or -1 if the file is not a snapshot.
+};
+
+/*! \class LambHeapCensus
+
+  Count of the cells in use by type, with the heap payload bytes they own, and of the free and issued cells in each block.
+  take() reads the GC state and type of every cell in block order, as the collector's sweep does, without following any reference,
+  so its cost is a few cycles per cell whatever the shape of the heap, and it allocates no cells.
+  A cell is in use if it is not on the free list: between a mark phase and the sweep that follows, that includes garbage not yet swept.
+  Issued cells are those allocated since the current collection cycle began.
+
+  A block's free cells form runs between cells in use; the fragmentation of a block is the share of its free cells outside its longest run, in percent.
+*/
+class LambHeapCensus {
+public:
+  //!Counts for one cell block.
+  struct Block {
+    Int_t free;
+    Int_t issued;
+    Int_t runs;		//!<Runs of free cells.
+    Int_t longest;	//!<Longest run of free cells.
+    Int_t frag_pct()	{ return free ? 100 - (100 * longest) / free : 0; }
+  };
+
+  LambHeapCensus()	{ block = 0;  Nblocks = 0; }
+  ~LambHeapCensus()	{ delete[] block; }
+
+  void take(Lamb &lamb);	//!<Count the cells of this VM's heap.
+
+  Word_t cells[Cell::Ntypes];	//!<Cells in use of each type.
+  Word_t bytes[Cell::Ntypes];	//!<Heap payload bytes owned by those cells, not counting the cells themselves.
+  Word_t Nfree;
+  Word_t Nissued;
+  Int_t Nblocks;
+  Block *block;
+  Int_t us;			//!<Time take() took.
+};
+
+/*! \class LambGCPacer
+
+  Pacing for the incremental collector.
+  By default Lamb::loop() offers the collector an idle-time quantum at the end of every loop that finishes early.
+  In *demand* mode those quanta are declined, so collection advances only as allocation requires it.
+  A loop that allocates nothing then pays nothing for GC, and the cells swept are the ones about to be reused.
+
+  In *deadline* mode each idle-time quantum is sized in microseconds to fit the slack left in the loop:
+  the target loop period, less the time the loop has already taken, less the jitter bound, capped at the GC budget.
+  The memory manager converts microseconds to cells using its own per-cell mark and sweep costs.
+  The gain corrects that conversion: it tracks the ratio of time actually spent to time requested, so that the quanta keep fitting as the costs drift.
+  When there is no slack the quantum is skipped, and collection falls back to allocation-time work.
+
+  The counters, together with the platform loop statistics, allow the modes to be compared on a real workload.
+  Pacing takes effect only when the GC entry points are interposed at link time (LL_GC_WRAP).
+*/
+class LambGCPacer {
+public:
+  enum { pace_idle, pace_demand, pace_deadline, Npacings };
+  static const Int_t gain_one = 256;	//!<Fixed-point 1.0 for the deadline gain.
+
+  LambGCPacer()		{ pacing = pace_idle;  period_us = budget_us = jitter_us = 0;  gain = gain_one;  reset(); }
+  void reset()		{ idle_calls = idle_runs = 0;  idle_us = 0;  idle_us_max = 0;  deadline_skips = deadline_overruns = 0; }
+
+  static const char *pacing_name(Int_t p)	{ static const char *names[] = { "idle", "demand", "deadline" };  return ((p >= 0) && (p < Npacings)) ? names[p] : "unknown"; }
+
+  //!Return the quantum to request from the memory manager in deadline mode, or 0 to skip it; *want* receives the time the quantum should take.
+  Int_t deadline_quantum(Int_t elapsed_us, Int_t &want) {
+    want = period_us - elapsed_us - jitter_us;
+    if (want > budget_us) want = budget_us;
+    if (want <= 0) return 0;
+    Int_t q = (Int_t) (((int64_t) want * gain_one) / gain);
+    return q ? q : 1;
+  }
+
+  //!Record a deadline-mode quantum that was asked for *q* us, was meant to take *want* us, and took *dt* us.
+  void deadline_account(Int_t q, Int_t want, Int_t dt) {
+    Int_t ratio = (Int_t) (((int64_t) dt * gain_one) / q);
+    gain += (ratio - gain) / 8;
+    if (gain < gain_one / 8) gain = gain_one / 8;
+    if (gain > gain_one * 16) gain = gain_one * 16;
+    if (dt > want + jitter_us) deadline_overruns++;
+  }
+
+  Int_t    pacing;		//!<Current pacing mode.
+  Word_t   idle_calls;		//!<Idle-time quanta offered by Lamb::loop().
+  Word_t   idle_runs;		//!<Idle-time quanta actually run.
+  uint64_t idle_us;		//!<Total time spent in idle-time quanta.
+  Int_t    idle_us_max;		//!<Longest idle-time quantum.
+
+  Int_t    period_us;		//!<Deadline mode: target loop period.
+  Int_t    budget_us;		//!<Deadline mode: most GC time per loop.
+  Int_t    jitter_us;		//!<Deadline mode: allowed overrun of the period.
+  Int_t    gain;		//!<Deadline mode: measured time over requested time, in units of gain_one.
+  Word_t   deadline_skips;	//!<Deadline mode: quanta skipped for lack of slack.
+  Word_t   deadline_overruns;	//!<Deadline mode: quanta that overran their slack by more than the jitter bound.
+};
+
+extern LambGCPacer lambGCPacer;
+
+/*! \class LambHistogram
+
+  Histogram with power-of-2 buckets: bucket 0 counts zeros, bucket k counts values in [2^(k-1), 2^k).
+  Percentiles are reported as the upper bound of the bucket holding them, never more than the maximum seen.
+*/
+class LambHistogram {
+public:
+  static const int Nbuckets = 40;
+
+  LambHistogram()	{ reset(); }
+  void reset()		{ memset(bucket, 0, sizeof(bucket));  count = total = max = 0; }
+
+  void add(uint64_t v, Word_t n = 1) {
+    int b = v ? 64 - __builtin_clzll(v) : 0;
+    bucket[(b < Nbuckets) ? b : Nbuckets - 1] += n;
+    count += n;
+    total += v * n;
+    if (v > max) max = v;
+  }
+
+  uint64_t percentile(Int_t pct) {
+    if (!count) return 0;
+    uint64_t rank = (count * pct + 99) / 100, seen = 0;
+    int b = 0;
+    while ((seen += bucket[b]) < rank) b++;
+    uint64_t hi = b ? ((((uint64_t) 1) << b) - 1) : 0;
+    return (hi < max) ? hi : max;
+  }
+
+  uint64_t count;	//!<Values added.
+  uint64_t total;	//!<Sum of values added.
+  uint64_t max;		//!<Largest value added.
+  uint64_t bucket[Nbuckets];
+};
+
+/*! \class LambGCTelemetry
+
+  Structured GC statistics for tuning loop budgets on a running system.
+  The VM library times each GC phase into its block timers (GCTimer_mark, GCTimer_sweep, GCTimer_pass, GC_stop_timer), which it only logs.
+  The interposed GC entry points (LL_GC_WRAP) read those timers after every call, and each call that did GC work adds one pause per phase to the histograms.
+  A pause is therefore what the mutator saw: an allocation that ran several quanta counts once, with their total time.
+
+  The same entry points count cell allocations, folded into a per-loop histogram at each loop boundary, and notice new cell blocks.
+  The Yuasa parameters are read from the memory manager as it last computed them with yuasa_analysis().
+*/
+class LambGCTelemetry {
+public:
+  enum { ph_mark, ph_sweep, ph_pass, ph_stop, Nphases };
+  static const Int_t Nexpands = 16;	//!<Expand events remembered.
+  static const Int_t Nyuasa   = 6;	//!<Values returned by yuasa().
+
+  LambGCTelemetry()	{ mm = 0;  reset(); }
+  void reset();
+
+  static const char *phase_name(Int_t ph)	{ static const char *names[] = { "mark", "sweep", "pass", "stop" };  return ((ph >= 0) && (ph < Nphases)) ? names[ph] : "unknown"; }
+
+  //!Account for one cell allocation, closing the per-loop count first if a new loop has started.
+  void alloc(LambMemoryManager *m) {
+    mm = m;
+    if (lambPlatform.loop_count() != seen_loop) loop_close();
+    allocs++;
+    loop_allocs_now++;
+  }
+
+  void observe();		//!<Fold any GC work done since the last call into the histograms.
+  Bool_t yuasa(Int_t v[]);	//!<Fill v with cells, free cells, Qm, Qs, M, N as last set by the collector; return false if no memory manager has been seen yet.
+  Int_t dump_json(const char *path);	//!<Write everything as JSON; return the bytes written, or -1.
+
+  LambHistogram pause[Nphases];	//!<Pause times in us, by phase.
+  LambHistogram loop_allocs;	//!<Cells allocated per loop.
+  uint64_t allocs;		//!<Cells allocated.
+
+  struct { Int_t ms;  Int_t blocks; } expands[Nexpands];	//!<Most recent expand events: time, blocks after.
+  Word_t Nexpand_events;	//!<Expand events seen.
+
+private:
+  struct Seen { uint64_t count;  uint64_t window;  uint64_t accum; } seen[Nphases];
+  LambMemoryManager *mm;
+  Word_t seen_loop;
+  Word_t loop_allocs_now;
+  Int_t seen_blocks;
+
+  void loop_close();
+};
+
+extern LambGCTelemetry lambGCTelemetry;
+
+/*! \class LambAllocProfiler
+
+  Sampling profiler for cell allocation, attributing allocations to the Lisp procedure and the native code making them.
+  Every *period* allocations, the interposed cell constructor (LL_GC_WRAP) records a sample of:
+  - the type of cell requested;
+  - the local variables of the environment it is allocated in, which identify the Lisp procedure (or let) running;
+  - on POSIX, the native return addresses, which identify the *mop3* or VM function calling tcons().
+
+  Samples are counted in a fixed table, so recording never allocates.
+  All the naming is deferred to report time: the variables are matched against the formals of the procedures bound in the interaction environment, and the addresses are looked up with dladdr() (link with -rdynamic).
+  When sampling is off the cost is one test per allocation.
+*/
+class LambAllocProfiler {
+public:
+  static const Int_t Nkeys  = 4;	//!<Local variable names kept per sample.
+  static const Int_t Npcs   = 6;	//!<Return addresses kept per sample.
+  static const Int_t Nsites = 1024;	//!<Distinct sites counted; later sites are lumped into *overflow*.
+
+  //!One line of the report.
+  struct Row {
+    Word_t samples;
+    Int_t typ;
+    char lisp[64];
+    char native[96];
+  };
+
+  LambAllocProfiler()	{ period = 0;  running = false;  clear(); }
+  void start(Int_t p);	//!<Clear the samples and sample every p allocations.
+  void stop()		{ running = false; }
+  void clear()		{ memset(sites, 0, sizeof(sites));  Nused = 0;  Nsamples = overflow = 0;  countdown = period; }
+
+  //!Count one allocation of type *typ* in *env_exec*, sampling it if its turn has come.
+  void tick(Int_t typ, Sexpr_t env_exec)	{ if (running && !--countdown) { countdown = period;  sample(typ, env_exec); } }
+
+  //!Fill *rows* with the samples merged by site name, largest first, and return the number of rows.
+  Int_t report(Lamb &lamb, Row *rows, Int_t Nmax);
+
+  bool   running;	//!<Sampling is on.
+  Int_t  period;	//!<Allocations per sample, kept after stop() to scale the report.
+  Word_t Nsamples;	//!<Samples taken.
+  Word_t overflow;	//!<Samples not counted for lack of table space.
+
+private:
+  struct Site {
+    Word_t samples;
+    Int_t typ;
+    Int_t Nvars;
+    Sexpr_t keys[Nkeys];
+    void *pcs[Npcs];
+  };
+  Site sites[Nsites];
+  Int_t Nused;
+  Int_t countdown;
+
+  void sample(Int_t typ, Sexpr_t env_exec);
+};
+
+extern LambAllocProfiler lambAllocProfiler;
+
+/*! \class LambSlab
+
+  Size-class slab allocator for small heap payloads (strings, bytevectors, vectors, symbols).
+  When the array operators are interposed at link time (LL_HEAP_WRAP), every payload the VM allocates up to max_bytes comes from here.
+  Each 64k chunk holds slots of a single size, so long-running programs do not fragment the system heap with small payloads.
+*/
+class LambSlab {
+public:
+  static const Int_t Nclasses    = 10;		//!<Number of size classes, 16 to 512 bytes.
+  static const Int_t max_bytes   = 512;		//!<Largest request served from a slab.
+  static const Int_t chunk_bytes = 1 << 16;	//!<Chunk size and alignment.
+
+  static void *alloc(size_t n);		//!<Return a slot of at least n bytes, or 0 if n is too large or no chunk could be had.
+  static Bool_t release(void *p);	//!<Return a slot to its chunk; return false if p did not come from a slab.
+  static void stats(Int_t cls, Int_t &size, Int_t &chunks, Int_t &used, Int_t &capacity);	//!<Report usage of one size class.
+  static Int_t trim();			//!<Free every empty chunk, ask the system allocator to return free pages to the OS, and return the slab bytes released.
+};
+
+/*! \class LambCellArena
+
+  Placement of the cell blocks added by the memory manager in LambMemoryManager::expand().
+  When the array operators are interposed (LL_HEAP_WRAP), every cell block passes through here.
+  A request of the block size is all that is seen of it, so another new[] of that size may be placed here too; that is harmless, as it only takes a slot in the region.
+  The tools therefore find the cells through the memory manager's own block table (LambCellHandle), never through the blocks placed here.
+
+  On Linux the blocks can be carved from a single 2MB-aligned region, so that marking and sweeping touch a few huge TLB entries rather than hundreds of small ones.
+  The region may use transparent huge pages (the default) or explicit hugetlbfs pages, may be bound to one NUMA node, and may be pre-faulted so that no page fault lands inside a loop() later on.
+  The placement must be chosen before the first block is allocated, that is before the Lamb VM is constructed.
+  setup() reads it from the environment:
+  - LAMB_CELL_PAGES: *small* (system allocator), *thp* (default) or *huge* (hugetlbfs, falls back to *thp*).
+  - LAMB_CELL_NUMA_NODE: node number to bind the region to, default none.
+  - LAMB_CELL_PREFAULT: 1 to touch the whole region at setup, default 0.
+*/
+class LambCellArena {
+public:
+  enum { pages_small, pages_thp, pages_huge, Npages };
+
+  static const Int_t cells_per_block = 8192;				//!<Cells in each block allocated by LambMemoryManager::expand().
+  static const Int_t block_bytes     = cells_per_block * sizeof(Cell);	//!<Size of the operator new[] request for a cell block.
+  static const Int_t region_bytes    = 4 << 20;				//!<Reserved huge-page region, two 2MB pages.
+  static const Int_t max_blocks      = region_bytes / block_bytes;	//!<Blocks tracked; more than the memory manager will ever ask for.
+
+  static void setup();						//!<Read the placement from the environment and reserve the region.
+  static void configure(Int_t pages, Int_t numa_node, Bool_t prefault);	//!<Choose the placement explicitly; has no effect once a block has been allocated.
+
+  static void *alloc(size_t n);		//!<Place a request of the cell block size, else return 0.
+  static Bool_t release(void *p);	//!<Forget a placed block; return false if p is not one.
+
+  static Int_t pages();			//!<The placement in effect.
+  static Int_t numa_node();		//!<The bound NUMA node, or -1.
+  static Int_t region_blocks();		//!<Number of blocks served from the region.
+  static const char *pages_name(Int_t p)	{ static const char *names[] = { "small", "thp", "huge" };  return ((p >= 0) && (p < Npages)) ? names[p] : "unknown"; }
+};
+
+/*! \class LambFinalizer
+
+  Deferred C++ deleters, run outside the GC sweep.
+  The sweep calls the deleter of each dead T_CPP_HEAP cell where it finds it, so a slow destructor (a CUDA stream, a socket) becomes a spike in loop() time.
+  An object made with the deleter LambFinalizer::deferred<D> has D queued instead, and run later by idle() from ::loop() between VM loops,
+  on the VM thread and in the order the sweep found the objects.
+  If the queue is full the queue is run first, then the deleter, so the order holds.
+
+  Worker threads are opt-in (POSIX only): LAMB_FINALIZER_THREADS, or set_workers(), starts a pool that runs the queue instead of idle().
+  Each worker takes its share of the queue, at most *batch* deleters, under one lock, so a burst from a large sweep is spread over the pool.
+  With workers, deleters run off the VM thread, concurrently with each other when there is more than one, and in any order;
+  only deleters that allow this should be deferred while a pool is running.
+
+  T_PORT_HEAP cells are still finalized in the sweep; the VM library closes and frees a port inline there.
+*/
+class LambFinalizer {
+public:
+  static const Int_t Nqueue = 256;	//!<Deleters waiting at most.
+  static const Int_t Nworkers_max = 16;
+  static const Int_t batch = 16;	//!<Deleters taken by a worker at once, at most.
+
+  //!Deleter for mk_cppobj() that queues D(obj) instead of running it.
+  template <CPPDeleterPtr D> static void deferred(void *obj)	{ defer(D, obj); }
+
+  static void defer(CPPDeleterPtr d, void *obj);	//!<Queue d(obj), or run it now, after the queue, if the queue is full.
+  static Int_t drain(Int_t max = Nqueue);		//!<Run up to max queued deleters on the calling thread and return the number run.
+  static void idle()					{ if (!worker_running()) drain(); }	//!<Run the queue between VM loops when there is no worker.
+  static void start_worker();				//!<Start the worker pool if LAMB_FINALIZER_THREADS asks for one (POSIX only).
+  static void set_workers(Int_t n);			//!<Grow or shrink the pool to n threads (POSIX only); with none, idle() runs the queue.
+  static Int_t workers();
+  static Bool_t worker_running()			{ return workers() > 0; }
+
+  //!Counters since start.
+  static void stats(Word_t &queued, Word_t &run, Word_t &inline_run, Int_t &depth, Int_t &depth_max);
+};
+
+
+/*! \class LambHeapPolicy
+
+  Sizing of the cell heap.
+  The memory manager starts with one block of cells and adds one block at a time, when a collection cycle finds the heap too small,
+  so new blocks arrive in the middle of a loop() at times set by the workload.
+  The policy adds blocks at times it chooses:
+  - *initial_blocks* as soon as the VM has been constructed, before setup.scm runs;
+  - after the memory manager grows the heap, more from ::loop() until it is *growth_pct* percent of its size before, so fewer growth events follow;
+  - none beyond *max_blocks*, by the manager or the policy: LambPlatform::free_heap() reports no room once it is reached.
+
+  The memory manager holds at most vm_max_blocks blocks of LambCellArena::cells_per_block cells.
+  Blocks are added only between collection phases where the manager itself adds them, so a request may wait a few loops.
+
+  expand() writes every cell of a new block, so pre-expanding faults the whole budget in before control starts.
+  On POSIX, *lock* then calls mlockall(), so that none of it is paged out later; with LL_HEAP_WRAP, LAMB_CELL_PREFAULT also pre-faults the reserved cell region.
+
+  Only on LL_GC_WRAP builds, where the memory manager's layout is known; elsewhere the heap grows as the manager decides, up to what LambPlatform::free_heap() reports.
+
+  The settings come from configure(), from setup() reading LAMB_HEAP_BLOCKS, LAMB_HEAP_MAX_BLOCKS, LAMB_HEAP_GROWTH_PCT and LAMB_HEAP_LOCK,
+  or from (GC.heap-policy ...) at the top of setup.scm.
+*/
+class LambHeapPolicy {
+public:
+  static const Int_t vm_max_blocks = 12;	//!<Size of the block table in LambMemoryManager.
+
+  static void setup();	//!<Read the settings from the environment (POSIX).
+  static void configure(Int_t initial_blocks, Int_t max_blocks, Int_t growth_pct, Bool_t lock);
+  static void apply(Lamb &lamb);	//!<Pre-expand to initial_blocks and lock memory if asked; call once the VM has been constructed.
+  static void idle(Lamb &lamb);		//!<Add the blocks due since the last call, between VM loops.
+  static Bool_t full();			//!<True once the heap has max_blocks blocks.
+  static Int_t blocks();		//!<Blocks in the heap now.
+
+  static Int_t initial_blocks;
+  static Int_t max_blocks;
+  static Int_t growth_pct;
+  static Bool_t lock;
+
+  static Bool_t locked;			//!<mlockall() succeeded.
+  static Word_t vm_expands;		//!<Blocks added by the memory manager.
+  static Word_t policy_expands;		//!<Blocks added by the policy.
+};
+
+/*! \class LambWeak
+
+  Weak boxes and ephemeron tables.
+  A weak box refers to a cell without keeping it alive; once the cell is garbage the box is broken and yields a default value.
+  An ephemeron table maps keys (compared with eq?) to values, and an entry keeps its value alive only while its key is reachable some other way.
+
+  The collector belongs to the VM library, so the weak references are kept strongly, in the vector %GC.weak-registry, where the library cannot free them.
+  The registry grows as needed.
+  sweep() is the weak-aware mark: a LambHeapWalker pass from the VM roots that does not enter the registry, marks the values of the ephemerons whose keys it has reached until nothing changes,
+  then breaks the weak boxes and drops the ephemeron entries whose cells were not reached.
+  The cells released that way are collected by the library on its next cycle.
+
+  idle() runs sweep() from ::loop() once the library has finished a collection cycle, at most every *interval_ms*.
+  Only there, between loops, is nothing held by the evaluator or in C++ locals, which the walk cannot see; so there is no sweep callable from Lisp.
+
+  Each box or table is a T_CPP_HEAP cell with a slot here; its deleter only marks the slot dead, so it is safe in the library's sweep.
+  The slot, and the registry element with it, are reused once the library has swept the cell.
+*/
+class LambWeak {
+public:
+  static void install(Lamb &lamb, Sexpr_t env_target, Sexpr_t env_exec);	//!<Make the registry and bind it in env_target.
+
+  static Sexpr_t mk_weak_box(Lamb &lamb, Sexpr_t target, Sexpr_t env_exec);
+  static Bool_t is_weak_box(Sexpr_t c);
+  static Sexpr_t weak_box_ref(Sexpr_t box, Sexpr_t dflt);	//!<The target, or dflt if the box is broken.
+
+  static Sexpr_t mk_ephemeron_table(Lamb &lamb, Int_t Nbuckets, Sexpr_t env_exec);	//!<Nbuckets is rounded up to a power of 2.
+  static Bool_t is_ephemeron_table(Sexpr_t c);
+  static Sexpr_t ephemeron_ref(Lamb &lamb, Sexpr_t table, Sexpr_t key, Sexpr_t dflt);
+  static void ephemeron_set(Lamb &lamb, Sexpr_t table, Sexpr_t key, Sexpr_t value, Sexpr_t env_exec);
+  static Bool_t ephemeron_delete(Lamb &lamb, Sexpr_t table, Sexpr_t key);	//!<Return false if the key was not there.
+  static Int_t ephemeron_count(Lamb &lamb, Sexpr_t table);
+
+  static void idle(Lamb &lamb);		//!<Sweep if the library has completed a collection cycle since the last sweep; call only from the top level of ::loop().
+
+  static Word_t interval_ms;	//!<Least time between sweeps from idle().
+
+  //!Counters since start.
+  static void stats(Int_t &used, Int_t &slots, Word_t &sweeps, Word_t &broken, Word_t &last_us);
+
+private:
+  static Int_t sweep(Lamb &lamb);	//!<Break the weak references to unreachable cells and return their number.
+};
+
+/*! \class LambCardTable
+
+  Card marking for the write barrier on large heap vectors.
+  The VM collector has a deletion barrier: while it is marking, a store into a vector first shades the element it overwrites, so the mark sees the heap as it was when marking began.
+  Elements are never rescanned; the cost is in the stores, and a large T_SVEC_HEAP or T_SVEC2N_HEAP hash frame updated every loop pays it on each one.
+
+  With LL_GC_WRAP, LambMemoryManager::vector_set_bang() is interposed, and for vectors of at least *min_elems* elements the barrier works on cards of 2^card_shift elements.
+  The first store into a card during a marking cycle shades the card's unmarked elements and sets its card byte; further stores into a dirty card are plain stores.
+  The card bytes are cleared when the next marking cycle starts.
+  Outside marking, and for small vectors, the store goes to the library as before.
+
+  Card bytes are kept for the Ntables most recently written vectors, keyed by vector cell and element array; a vector that loses its table only shades its cards again.
+  A dirty card's later stores skip the barrier, so a table must never outlive its array: payload_freed() drops it as the array is deleted (LL_HEAP_WRAP),
+  and the vector cell in the key keeps a new vector from taking it over at the same address.
+*/
+class LambCardTable {
+public:
+  static const Int_t card_shift = 6;	//!<64 elements per card.
+  static const Int_t min_elems  = 256;	//!<Smaller vectors keep the per-store barrier.
+  static const Int_t Ntables    = 16;
+
+  static void vector_set(LambMemoryManager *mm, Sexpr_t vec, Int_t k, Sexpr_t val);	//!<The interposed LambMemoryManager::vector_set_bang().
+  static void payload_freed(void *p)	{ if (Nlive) forget(p); }	//!<Called as any heap array is deleted.
+
+  //!Counters since start.
+  static Word_t stores;		//!<Stores made while marking.
+  static Word_t clean_stores;	//!<Of those, stores into a card already dirty, without a barrier.
+  static Word_t cards_dirtied;
+  static Word_t shaded;		//!<Elements shaded when their card was dirtied.
+
+private:
+  struct Table { Sexpr_t vec;  Sexpr_t *elems;  Int_t Nelems;  Word_t epoch;  Int_t Ncards;  uint8_t *cards; };
+  static Table tables[Ntables];
+  static Int_t Nlive;		//!<Tables in use.
+  static Int_t next;
+  static Word_t epoch;
+  static Int_t seen_cycles;
+  static Bool_t marking;
+
+  static Table *lookup(Sexpr_t vec, Sexpr_t *elems, Int_t Nelems);
+  static void forget(void *elems);
+};
+
+/*! \class LambExternal
+
+  Accounting of native memory held behind cells.
+  A T_CPP_HEAP cell is one cell to the collector however much its object holds, a pinned DMA buffer or an image,
+  so a program that makes few cells but many such objects runs short of memory long before the cell heap asks for a collection.
+
+  Lamb::mk_cppobj() with a byte count charges those bytes here, and credits them when the library sweeps the cell.
+  On LL_HEAP_WRAP builds, Lamb::mk_bytevector_counted() does the same for a heap bytevector's payload, credited when the payload is deleted.
+  Memory seen through mk_bytevector_ext() belongs to whatever frees it; charge it on that object's cell.
+
+  The bytes charged since the last collection cycle ended are the debt.
+  While a cycle runs, each charge also runs GC quanta (LambMemoryManager::gc_pass()) in proportion, so that the cycle ends by the time budget() more is charged,
+  budget() being the larger of min_bytes and growth_pct percent of the external bytes that lived through the last cycle.
+  Once the debt reaches budget() with the collector idle, each charge offers it a GC quantum, which starts a cycle as soon as the library's own trigger allows;
+  the trigger itself, the free-cell threshold of the Yuasa analysis, is left to the library.
+  Only on LL_GC_WRAP builds; elsewhere the bytes are only counted.
+*/
+class LambExternal {
+public:
+  static void bind(Lamb &lamb);		//!<Follow this VM's memory manager.
+  static void charge(Word_t bytes, Sexpr_t env_exec);	//!<Count native memory now held by a cell, and run GC quanta for the debt.
+  static void credit(Word_t bytes);	//!<Count native memory released.
+  static Word_t budget();		//!<Debt that a cycle must keep up with.
+
+  static Bool_t track(void *obj, CPPDeleterPtr deleter, Word_t bytes, Sexpr_t env_exec);	//!<Charge bytes until release() or payload_freed() is called with obj; false, and nothing charged, if the table cannot grow.
+  static void release(void *obj);		//!<The deleter of counted T_CPP_HEAP cells: credit the object and call its own deleter.
+  static void payload_freed(void *p)	{ if (Ntracked) untrack(p); }	//!<Called as any heap array is deleted.
+
+  static Word_t min_bytes;	//!<Least budget.
+  static Int_t growth_pct;	//!<Budget, as a percentage of the external bytes that lived through the last cycle.
+
+  //!Counters since start.
+  static Word_t live;		//!<External bytes held now.
+  static Word_t live_max;
+  static Word_t charged;
+  static Word_t triggers;	//!<Cycles begun in a quantum offered for external memory.
+  static Word_t quanta;		//!<GC quanta run for external memory.
+
+private:
+  static Int_t Ntracked;
+  static void untrack(void *p);
+};
+
+/*! \class LambAllocScope
+
+  Accounting of the cells allocated within a scope, and of those that outlive it.
+  Most of what a control loop allocates is dead when the loop returns; the cells it stores into older structures are what keep a collection busy.
+  The VM library places every cell and native frames hold raw cell pointers, so cells cannot be moved out of a region or freed wholesale here.
+  Instead the scope tells how much of its allocation is temporary, and which part escapes, so that the escapes can be found and removed.
+
+  While a scope is open, the interposed cell constructors (LL_GC_WRAP) mark each new cell in a side-table bitmap,
+  and the interposed barriers count a new cell as escaped when it is stored into one allocated before the outermost open scope.
+  The new cells it holds escape with it, and every cell is counted once.
+  Cells held only by native frames, or returned as the scope's value, are not seen leaving.
+
+  Scopes nest, each counting what is allocated and escapes while it is open, its inner scopes included.
+  main.cpp opens one around each Lamb::loop() when *per_loop* is set.
+*/
+class LambAllocScope {
+public:
+  LambAllocScope(Bool_t open = true);	//!<Open a scope inside the current one; with *open* false, do nothing.
+  ~LambAllocScope();			//!<Close the scope and add its counts to the totals.
+
+  //!Count a new cell; called by the interposed cell constructors.
+  static void allocated(Sexpr_t c)		{ if (current) { young->test_and_set(c);  allocs++; } }
+
+  //!Count the escape of *val* stored into *dst*; called by the interposed barriers.
+  static void stored(Sexpr_t dst, Sexpr_t val)	{ if (current && young->test(val) && !young->test(dst)) escape(val); }
+
+  Word_t cells();	//!<Cells allocated since the scope opened.
+  Word_t escaped();	//!<Cells escaped since the scope opened.
+
+  static LambAllocScope *current;	//!<The innermost open scope, 0 if none.
+  static Bool_t per_loop;		//!<Open a scope around each Lamb::loop().
+
+  //!Counters of closed scopes since start.
+  static Word_t scopes;
+  static Word_t total_cells;
+  static Word_t total_escaped;
+  static Word_t max_cells;		//!<Most cells allocated in one scope.
+  static Word_t last_cells;		//!<Cells allocated in the last scope closed.
+  static Word_t last_escaped;		//!<Cells escaped from the last scope closed.
+
+private:
+  LambAllocScope *outer;
+  Bool_t open;
+  Word_t allocs0, escapes0;
+
+  static LambMarkBitmap *young;		//!<Cells allocated in the open scopes and not escaped.
+  static Word_t allocs, escapes;	//!<Cells allocated and escaped while any scope was open.
+  static void escape(Sexpr_t c);
+};
+
+#endif
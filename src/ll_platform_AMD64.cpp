@@ -1,6 +1,7 @@
 #if LL_AMD64
 
 #include "ll_platform_generic.h"
+#include "ll_gc.h"
 #include <sys/time.h>
 
 unsigned long micros(void)
@@ -27,7 +28,11 @@ void delay_ms(unsigned long ms)	{ unsigned long end = millis() + ms;  while (mil
 void delay_us(unsigned long ms)	{ unsigned long end = micros() + ms;  while (micros() < end) /*wait*/; }
 
 Int_t  LambPlatform::free_stack()			{ return 1<<10; /*just say 1k left*/ }
+#if LL_GC_WRAP
+Int_t  LambPlatform::free_heap()			{ return LambHeapPolicy::full() ? 0 : 1<<20; /*just say 1 meg free, up to the heap policy limit */ }
+#else
 Int_t  LambPlatform::free_heap()			{ return 1<<20; /*just say 1 meg free */ }
+#endif
 void   LambPlatform::rand(byte *buf, Int_t len)		{}
 Bool_t LambPlatform::heap_integrity_check(bool foo)	{ return 1; }
 void   LambPlatform::reboot()				{}
@@ -49,8 +54,10 @@ void LambPlatform::end() {}
 
 void LambPlatform::loop(void)	//call this 1st thing in Lamb::loop().
 {
+  Int_t now_us  = micros();
+  loop_account(now_us - loop_start_us);
   loop_start_ms = millis();
-  loop_start_us = micros();
+  loop_start_us = now_us;
 }
 
 #endif
@@ -17,8 +17,10 @@ void LambPlatform::end() {}
 
 void LambPlatform::loop(void)	//call this 1st thing in Lamb::loop().
 {
+  Int_t now_us  = micros();
+  loop_account(now_us - loop_start_us);
   loop_start_ms = millis();
-  loop_start_us = micros();
+  loop_start_us = now_us;
 }
 
 void LambPlatform::reboot()			{ esp_restart(); }
@@ -27,6 +29,13 @@ Int_t LambPlatform::free_heap()			{ return (Int_t) esp_get_free_heap_size(); }
 Int_t LambPlatform::free_stack()		{ return (Int_t) uxTaskGetStackHighWaterMark(NULL); }
 void  LambPlatform::rand(byte *buf, Int_t len)	{ esp_fill_random(buf, (size_t) len); }
 
+//The Arduino loop task is created already pinned to ARDUINO_RUNNING_CORE, so only its priority can be changed here.
+Bool_t LambPlatform::pin_loop(Int_t core, Int_t rt_priority)
+{
+  if (rt_priority > 0) vTaskPrioritySet(NULL, (rt_priority < configMAX_PRIORITIES) ? rt_priority : configMAX_PRIORITIES - 1);
+  return (core < 0) || (core == xPortGetCoreID());
+}
+
 
 Bool_t LambPlatform::heap_integrity_check(Bool_t complain)
 {
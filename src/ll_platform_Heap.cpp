@@ -0,0 +1,398 @@
+#include "ll_gc.h"
+
+#if LL_HEAP_WRAP
+
+#include <stdlib.h>
+#include <errno.h>
+#if LL_POSIX
+#include <malloc.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#endif
+
+/*
+  Size-class slab allocator for the heap payloads of strings, bytevectors, vectors and symbols.
+
+  The Lamb VM library allocates every payload with operator new[] and frees it with operator delete[] when the owning cell is swept.
+  Linking with --wrap on those operators routes them here.
+  Small requests are served from 64k chunks, each dedicated to one size class, using a per-chunk free list and a bump pointer for never-used slots.
+  Requests larger than the biggest class, and pointers not found in a slab chunk, go to the original operators.
+
+  All bookkeeping uses malloc() directly, never new[], so the allocator cannot recurse into itself.
+  A spinlock makes it safe for finalizers running on other threads; the mutator is normally the only user, so the lock is uncontended.
+*/
+
+static const Int_t slab_sizes[] = { 16, 32, 48, 64, 96, 128, 192, 256, 384, 512 };
+static const Int_t slab_header  = 64;		//keeps slots 16-aligned, as operator new[] must
+static const Word_t slab_mask   = LambSlab::chunk_bytes - 1;
+
+struct SlabChunk {
+  SlabChunk *next;	//chunks of the same class having free slots
+  SlabChunk *prev;
+  void *free;		//released slots
+  Int_t cls;
+  Int_t nused;
+  Int_t nslots;
+  Int_t bump;		//slots at and above this index have never been handed out
+};
+
+static_assert(sizeof(SlabChunk) <= slab_header, "SlabChunk header too large\n");
+
+static struct {
+  SlabChunk *avail;
+  Int_t Nchunks;
+  Int_t Nused;
+} slab_class[LambSlab::Nclasses];
+
+static unsigned char slab_class_of[LambSlab::max_bytes / 16 + 1];	//(bytes + 15) / 16 => class
+static Word_t *slab_registry;		//open-addressed set of chunk addresses
+static Int_t slab_registry_slots;
+static Int_t slab_registry_count;
+static Word_t slab_lo = ~((Word_t) 0);	//address range covered by chunks, to reject foreign pointers cheaply
+static Word_t slab_hi = 0;
+static char slab_lock;
+static bool slab_ready;
+
+static void lock()	{ while (__atomic_test_and_set(&slab_lock, __ATOMIC_ACQUIRE)) /*spin*/; }
+static void unlock()	{ __atomic_clear(&slab_lock, __ATOMIC_RELEASE); }
+
+static Word_t registry_hash(Word_t chunk)	{ return ((chunk >> 16) * 2654435761u) & (slab_registry_slots - 1); }
+
+static bool registry_has(Word_t chunk)
+{
+  if (!slab_registry) return false;
+  for (Word_t ix = registry_hash(chunk); slab_registry[ix]; ix = (ix + 1) & (slab_registry_slots - 1))
+    if (slab_registry[ix] == chunk) return true;
+  return false;
+}
+
+static bool registry_add(Word_t chunk)
+{
+  if (2 * (slab_registry_count + 1) > slab_registry_slots) {
+    Word_t *old = slab_registry;
+    Int_t Nold  = slab_registry_slots;
+    Int_t Nnew  = Nold ? 2 * Nold : 256;
+    Word_t *tbl = (Word_t *) calloc(Nnew, sizeof(Word_t));
+    if (!tbl) return false;
+    slab_registry       = tbl;
+    slab_registry_slots = Nnew;
+    slab_registry_count = 0;
+    for (Int_t i=0; i<Nold; i++) if (old[i]) registry_add(old[i]);
+    free(old);
+  }
+  Word_t ix = registry_hash(chunk);
+  while (slab_registry[ix]) ix = (ix + 1) & (slab_registry_slots - 1);
+  slab_registry[ix] = chunk;
+  slab_registry_count++;
+  return true;
+}
+
+static void registry_remove(Word_t chunk)
+{
+  Word_t mask = slab_registry_slots - 1;
+  Word_t ix   = registry_hash(chunk);
+  while (slab_registry[ix] != chunk) ix = (ix + 1) & mask;
+  slab_registry[ix] = 0;
+  slab_registry_count--;
+
+  //Reinsert the rest of the probe cluster so that no lookup stops short at the new hole.
+  for (ix = (ix + 1) & mask; slab_registry[ix]; ix = (ix + 1) & mask) {
+    Word_t c = slab_registry[ix];
+    slab_registry[ix] = 0;
+    slab_registry_count--;
+    registry_add(c);
+  }
+}
+
+static void avail_link(SlabChunk *ch)
+{
+  SlabChunk *&head = slab_class[ch->cls].avail;
+  ch->prev = 0;
+  ch->next = head;
+  if (head) head->prev = ch;
+  head = ch;
+}
+
+static void avail_unlink(SlabChunk *ch)
+{
+  if (ch->prev) ch->prev->next = ch->next;
+  else slab_class[ch->cls].avail = ch->next;
+  if (ch->next) ch->next->prev = ch->prev;
+  ch->next = ch->prev = 0;
+}
+
+static SlabChunk *chunk_new(Int_t cls)
+{
+  void *mem = 0;
+  if (posix_memalign(&mem, LambSlab::chunk_bytes, LambSlab::chunk_bytes)) return 0;
+
+  Word_t a = (Word_t) mem;
+  if (!registry_add(a)) { free(mem);  return 0; }
+  if (a < slab_lo) slab_lo = a;
+  if (a + LambSlab::chunk_bytes > slab_hi) slab_hi = a + LambSlab::chunk_bytes;
+
+  SlabChunk *ch = (SlabChunk *) mem;
+  ch->free   = 0;
+  ch->cls    = cls;
+  ch->nused  = 0;
+  ch->nslots = (LambSlab::chunk_bytes - slab_header) / slab_sizes[cls];
+  ch->bump   = 0;
+  avail_link(ch);
+  slab_class[cls].Nchunks++;
+  return ch;
+}
+
+void *LambSlab::alloc(size_t n)
+{
+  if (n > (size_t) max_bytes) return 0;
+
+  lock();
+  if (!slab_ready) {
+    Int_t c = 0;
+    for (Int_t i=0; i<=max_bytes/16; i++) {
+      while (slab_sizes[c] < 16 * i) c++;
+      slab_class_of[i] = c;
+    }
+    slab_ready = true;
+  }
+
+  Int_t cls = slab_class_of[(n + 15) >> 4];
+  SlabChunk *ch = slab_class[cls].avail;
+  if (!ch && !(ch = chunk_new(cls))) { unlock();  return 0; }
+
+  void *p;
+  if (ch->free) {
+    p = ch->free;
+    ch->free = *(void **) p;
+  }
+  else p = ((char *) ch) + slab_header + ch->bump++ * slab_sizes[cls];
+
+  if (++ch->nused == ch->nslots) avail_unlink(ch);
+  slab_class[cls].Nused++;
+  unlock();
+  return p;
+}
+
+Bool_t LambSlab::release(void *p)
+{
+  Word_t a    = (Word_t) p;
+  Word_t base = a & ~slab_mask;
+  lock();
+  if ((a < slab_lo) || (a >= slab_hi) || !registry_has(base)) { unlock();  return false; }
+
+  SlabChunk *ch = (SlabChunk *) base;
+  if (ch->nused == ch->nslots) avail_link(ch);
+  *(void **) p = ch->free;
+  ch->free = p;
+  ch->nused--;
+  slab_class[ch->cls].Nused--;
+  unlock();
+  return true;
+}
+
+Int_t LambSlab::trim()
+{
+  Int_t released = 0;
+  lock();
+  for (Int_t cls=0; cls<Nclasses; cls++) {
+    SlabChunk *ch = slab_class[cls].avail;
+    while (ch) {
+      SlabChunk *next = ch->next;
+      if (ch->nused == 0) {
+	avail_unlink(ch);
+	registry_remove((Word_t) ch);
+	slab_class[cls].Nchunks--;
+	free(ch);
+	released += chunk_bytes;
+      }
+      ch = next;
+    }
+  }
+  unlock();
+
+#if LL_POSIX
+  malloc_trim(0);	//let glibc hand the freed chunks and any other free pages back to the OS
+#endif
+  return released;
+}
+
+void LambSlab::stats(Int_t cls, Int_t &size, Int_t &chunks, Int_t &used, Int_t &capacity)
+{
+  size     = slab_sizes[cls];
+  chunks   = slab_class[cls].Nchunks;
+  used     = slab_class[cls].Nused;
+  capacity = chunks * ((chunk_bytes - slab_header) / size);
+}
+
+/*
+  Cell block placement.
+  Blocks come and go only in expand() and Lamb::end(), so the bookkeeping is a pair of small arrays under the slab lock.
+*/
+static const Word_t huge_bytes = 2 << 20;
+
+static Sexpr_t arena_blocks[LambCellArena::max_blocks];	//every live placed block, compacted
+static Int_t arena_Nblocks;
+static char *arena_region;				//2MB-aligned, 0 if not reserved
+static bool arena_slot_used[LambCellArena::max_blocks];
+static Int_t arena_Nregion;
+static Int_t arena_pages = LambCellArena::pages_thp;
+static Int_t arena_node  = -1;
+static bool arena_prefault;
+static bool arena_reserved;	//placement is frozen after the first reservation attempt
+
+#if LL_POSIX
+static char *region_map()
+{
+  ME("::region_map()");
+  if (arena_pages == LambCellArena::pages_huge) {
+    void *p = mmap(0, LambCellArena::region_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) return (char *) p;
+    global_printf("%s no hugetlbfs pages available (%s), using transparent huge pages\n", me, strerror(errno));
+    arena_pages = LambCellArena::pages_thp;
+  }
+
+  //Over-allocate by one huge page and trim, to get 2MB alignment from a plain anonymous mapping.
+  size_t len = LambCellArena::region_bytes + huge_bytes;
+  char *p = (char *) mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == (char *) MAP_FAILED) return 0;
+  char *a   = (char *) ((((Word_t) p) + huge_bytes - 1) & ~(huge_bytes - 1));
+  char *end = a + LambCellArena::region_bytes;
+  if (a > p) munmap(p, a - p);
+  if (p + len > end) munmap(end, (p + len) - end);
+  if (madvise(a, LambCellArena::region_bytes, MADV_HUGEPAGE))
+    global_printf("%s transparent huge pages unavailable: %s\n", me, strerror(errno));
+  return a;
+}
+
+static void region_place(char *a)
+{
+  ME("::region_place()");
+  if (arena_node >= 0) {
+    unsigned long mask[16] = { 0 };
+    if (arena_node < (Int_t) (8 * sizeof(mask))) mask[arena_node / 64] = 1UL << (arena_node % 64);
+    if (syscall(SYS_mbind, a, LambCellArena::region_bytes, MPOL_BIND, mask, 8 * sizeof(mask), 0)) {
+      global_printf("%s cannot bind cells to NUMA node %d: %s\n", me, arena_node, strerror(errno));
+      arena_node = -1;
+    }
+  }
+  if (arena_prefault) for (Int_t off=0; off<LambCellArena::region_bytes; off+=4096) a[off] = 0;
+}
+#endif
+
+static void region_reserve()
+{
+  arena_reserved = true;
+#if LL_POSIX
+  if (arena_pages == LambCellArena::pages_small) return;
+  if (!(arena_region = region_map())) { arena_pages = LambCellArena::pages_small;  return; }
+  region_place(arena_region);
+#else
+  arena_pages = LambCellArena::pages_small;
+#endif
+}
+
+void LambCellArena::configure(Int_t pages, Int_t numa_node, Bool_t prefault)
+{
+  lock();
+  if (!arena_reserved) {
+    arena_pages    = ((pages >= 0) && (pages < Npages)) ? pages : pages_thp;
+    arena_node     = numa_node;
+    arena_prefault = prefault;
+    region_reserve();
+  }
+  unlock();
+}
+
+void LambCellArena::setup()
+{
+  ME("LambCellArena::setup()");
+  Int_t pages     = pages_thp;
+  Int_t node      = -1;
+  Bool_t prefault = false;
+#if LL_POSIX
+  const char *s;
+  if ((s = getenv("LAMB_CELL_PAGES"))) {
+    for (pages = 0; (pages < Npages) && strcmp(s, pages_name(pages)); pages++) /*search*/;
+    if (pages == Npages) { global_printf("%s unknown LAMB_CELL_PAGES %s\n", me, s);  pages = pages_thp; }
+  }
+  if ((s = getenv("LAMB_CELL_NUMA_NODE"))) node = atoi(s);
+  if ((s = getenv("LAMB_CELL_PREFAULT"))) prefault = atoi(s) != 0;
+#endif
+  configure(pages, node, prefault);
+  global_printf("%s cell blocks on %s pages, NUMA node %d%s\n", me, pages_name(arena_pages), arena_node, arena_prefault ? ", pre-faulted" : "");
+}
+
+void *LambCellArena::alloc(size_t n)
+{
+  if (n != (size_t) block_bytes) return 0;
+
+  lock();
+  if (!arena_reserved) region_reserve();
+  if (arena_Nblocks == max_blocks) { unlock();  return 0; }
+
+  char *p = 0;
+  if (arena_region) {
+    for (Int_t i=0; i<max_blocks; i++) {
+      if (arena_slot_used[i]) continue;
+      arena_slot_used[i] = true;
+      arena_Nregion++;
+      p = arena_region + i * block_bytes;
+      break;
+    }
+  }
+  if (!p) p = (char *) malloc(n);
+  if (p) arena_blocks[arena_Nblocks++] = (Sexpr_t) p;
+  unlock();
+  return p;
+}
+
+Bool_t LambCellArena::release(void *p)
+{
+  lock();
+  Int_t i = 0;
+  while ((i < arena_Nblocks) && (arena_blocks[i] != (Sexpr_t) p)) i++;
+  if (i == arena_Nblocks) { unlock();  return false; }
+  arena_blocks[i] = arena_blocks[--arena_Nblocks];
+
+  char *c = (char *) p;
+  if (arena_region && (c >= arena_region) && (c < arena_region + region_bytes)) {
+    arena_slot_used[(c - arena_region) / block_bytes] = false;
+    arena_Nregion--;
+  }
+  else free(p);
+  unlock();
+  return true;
+}
+
+Int_t LambCellArena::pages()		{ return arena_pages; }
+Int_t LambCellArena::numa_node()	{ return arena_node; }
+Int_t LambCellArena::region_blocks()	{ return arena_Nregion; }
+
+/*
+  Interposed array operators.  The library uses only the unsized forms; the sized delete[] is wrapped too, in case open code emits it.
+*/
+void *ll_new_array_real(size_t n) asm("__real__Znam");
+void  ll_delete_array_real(void *p) asm("__real__ZdaPv");
+void *ll_new_array_wrap(size_t n) asm("__wrap__Znam");
+void  ll_delete_array_wrap(void *p) asm("__wrap__ZdaPv");
+void  ll_delete_array_sized_wrap(void *p, size_t n) asm("__wrap__ZdaPvm");
+
+void *ll_new_array_wrap(size_t n)
+{
+  void *p = LambSlab::alloc(n);
+  if (!p) p = LambCellArena::alloc(n);
+  return p ? p : ll_new_array_real(n);
+}
+
+void ll_delete_array_wrap(void *p)
+{
+  LambExternal::payload_freed(p);
+  LambCardTable::payload_freed(p);
+  if (!LambSlab::release(p) && !LambCellArena::release(p)) ll_delete_array_real(p);
+}
+
+void ll_delete_array_sized_wrap(void *p, size_t n)	{ ll_delete_array_wrap(p); }
+
+#endif
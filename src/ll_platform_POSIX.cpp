@@ -1,2 +1,40 @@
 #include "ll_platform_generic.h"
 
+#if LL_POSIX
+
+#include <sched.h>
+#include <pthread.h>
+#include <string.h>
+
+Bool_t LambPlatform::pin_loop(Int_t core, Int_t rt_priority)
+{
+  ME("LambPlatform::pin_loop()");
+  Bool_t ok = true;
+
+  if (core >= 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (err) {
+      global_printf("%s cannot pin to core %d: %s\n", me, core, strerror(err));
+      ok = false;
+    }
+  }
+
+  if (rt_priority > 0) {
+    struct sched_param sp;
+    int pmin = sched_get_priority_min(SCHED_FIFO);
+    int pmax = sched_get_priority_max(SCHED_FIFO);
+    sp.sched_priority = (rt_priority < pmin) ? pmin : (rt_priority > pmax) ? pmax : rt_priority;
+    int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+    if (err) {
+      global_printf("%s cannot set SCHED_FIFO priority %d: %s\n", me, sp.sched_priority, strerror(err));
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+#endif
@@ -235,7 +235,7 @@ public:
 
   //! @name Interaction with the underlying runtime platform.
   //!@{
-  LambPlatform() {}
+  LambPlatform() { loop_stats_reset(); }
   ~LambPlatform() { end(); }
 
   void begin(void);
@@ -251,6 +251,12 @@ public:
   Int_t free_stack();			//!<Return the unused execution stack space available.  Accuracy is specifically not guaranteed.
   Bool_t heap_integrity_check(Bool_t complain=false);	//!<Run intensive heap check; print errors if found; return true if errors found.
 
+  /*!Pin the thread running loop() to one CPU core (-1 leaves affinity alone), and optionally raise it to real-time priority.
+    On a multicore host this keeps the mutator and the incremental GC quanta it runs away from other work, reducing loop jitter.
+    Return true if everything requested was applied.
+  */
+  Bool_t pin_loop(Int_t core, Int_t rt_priority = 0);
+
   //!Return a real number between -1.0 and +1.0.  May include -1.0 but not +1.0.
   Real_t rand11() {
     const int max_int = (~((unsigned int) 0)) >> 1;
@@ -273,9 +279,29 @@ public:
 
   //!@}
 
+  //! @name Loop timing statistics, accumulated by loop() so that runtime settings (such as GC pacing) can be compared.
+  //!@{
+  Word_t loop_count()		{ return loops; }		//!<Return the number of loops timed since the last reset.
+  uint64_t loop_us_total()	{ return loops_us; }		//!<Return the total time spent in the loops timed.
+  Int_t  loop_us_max()		{ return loops_us_max; }	//!<Return the longest loop timed.
+  void   loop_stats_reset()	{ loops = 0;  loops_us = 0;  loops_us_max = 0; }
+  //!@}
+
 private:
   Int_t loop_start_ms;
   Int_t loop_start_us;
+
+  //Added after the members used by the inline loop_elapsed functions, so their offsets are unchanged.
+  Word_t loops;
+  uint64_t loops_us;
+  Int_t  loops_us_max;
+  Bool_t loops_started;
+
+  //The first call measures from begin(), through setup() and the loading of setup.scm, so it is not counted as a loop.
+  void loop_account(Int_t dt_us) {
+    if (!loops_started) { loops_started = true;  return; }
+    loops++;  loops_us += dt_us;  if (dt_us > loops_us_max) loops_us_max = dt_us;
+  }
 };
 
 extern LambPlatform lambPlatform;
@@ -1,4 +1,5 @@
 #include "LambLisp.h"
+#include "ll_gc.h"
 
 #if LL_CUDA
 #include "cuda_runtime.h"
@@ -208,7 +209,7 @@ Sexpr_t mop3_cudaStreamCreate(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
   cudaStream_t *s = new cudaStream_t;
   cudaStreamCreate(s);
 
-  CPPDeleterPtr p = &cudaStreamDestroyer;
+  CPPDeleterPtr p = &LambFinalizer::deferred<cudaStreamDestroyer>;	//cudaStreamDestroy() may wait for the stream, keep it out of the sweep
   return lamb.tcons(Cell::T_CPP_HEAP, (Word_t) p, (Word_t) s, env_exec);
 }
 
@@ -251,53 +252,49 @@ Sexpr_t mop3_cudaGetDeviceProp(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
 
     Sexpr_t alist = NIL;
 
-    Sexpr_t sym = lamb.mk_symbol("name", env_exec);
-    lamb.gc_root_push(sym);
-    Sexpr_t vec = lamb.mk_string(sizeof(prop.name), prop.name, env_exec);
-    Sexpr_t pair = lamb.cons(sym, vec, env_exec);
-    lamb.gc_root_pop();
-
-    alist = lamb.cons(pair, alist, env_exec);
-    lamb.gc_root_push(alist);
-  
-    sym = lamb.mk_symbol("uuid", env_exec);
-    lamb.gc_root_push(sym);
-  
-    vec   = lamb.mk_bytevector(sizeof(prop.uuid), (Bytest_t) &prop.uuid, env_exec);
-    pair  = lamb.cons(sym, vec, env_exec);
-    alist = lamb.cons(pair, alist, env_exec);
-    lamb.gc_root_pop(2);
+    {
+      LambRootScope roots(lamb);
+      Sexpr_t sym  = roots.protect(lamb.mk_symbol("name", env_exec));
+      Sexpr_t vec  = lamb.mk_string(sizeof(prop.name), prop.name, env_exec);
+      Sexpr_t pair = lamb.cons(sym, vec, env_exec);
+      alist = lamb.cons(pair, alist, env_exec);
+    }
+    {
+      LambRootScope roots(lamb);
+      roots.protect(alist);
+      Sexpr_t sym  = roots.protect(lamb.mk_symbol("uuid", env_exec));
+      Sexpr_t vec  = lamb.mk_bytevector(sizeof(prop.uuid), (Bytest_t) &prop.uuid, env_exec);
+      Sexpr_t pair = lamb.cons(sym, vec, env_exec);
+      alist = lamb.cons(pair, alist, env_exec);
+    }
   
 #define mk_int_field(__name) {					\
-      lamb.gc_root_push(alist);					\
-      Sexpr_t sym  = lamb.mk_symbol(#__name, env_exec);		\
-      lamb.gc_root_push(sym);					\
+      LambRootScope roots(lamb);				\
+      roots.protect(alist);					\
+      Sexpr_t sym  = roots.protect(lamb.mk_symbol(#__name, env_exec));	\
       Sexpr_t ival = lamb.mk_integer(prop.__name, env_exec);	\
       Sexpr_t pair = lamb.cons(sym, ival, env_exec);		\
       alist = lamb.cons(pair, alist, env_exec);			\
-      lamb.gc_root_pop(2);					\
     }								\
     //
 
 #define mk_int2_field(__name) {						\
-      lamb.gc_root_push(alist);						\
-      Sexpr_t sym  = lamb.mk_symbol(#__name, env_exec);			\
-      lamb.gc_root_push(sym);						\
+      LambRootScope roots(lamb);					\
+      roots.protect(alist);						\
+      Sexpr_t sym  = roots.protect(lamb.mk_symbol(#__name, env_exec));	\
       Sexpr_t vec  = lamb.mk_bytevector(2 * sizeof(int), (Bytest_t) prop.__name, env_exec); \
       Sexpr_t pair = lamb.cons(sym, vec, env_exec);			\
       alist = lamb.cons(pair, alist, env_exec);				\
-      lamb.gc_root_pop(2);						\
     }									\
     //
 
 #define mk_int3_field(__name) {						\
-      lamb.gc_root_push(alist);						\
-      Sexpr_t sym  = lamb.mk_symbol(#__name, env_exec);			\
-      lamb.gc_root_push(sym);						\
+      LambRootScope roots(lamb);					\
+      roots.protect(alist);						\
+      Sexpr_t sym  = roots.protect(lamb.mk_symbol(#__name, env_exec));	\
       Sexpr_t vec  = lamb.mk_bytevector(3 * sizeof(int), (Bytest_t) prop.__name, env_exec); \
       Sexpr_t pair = lamb.cons(sym, vec, env_exec);			\
       alist = lamb.cons(pair, alist, env_exec);				\
-      lamb.gc_root_pop(2);						\
     }									\
     //
     
@@ -415,10 +412,9 @@ Sexpr_t Cuda_install_mop3(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
     lamb.log("%s defining %d Mops\n", me, Nstd_procs);
     Sexpr_t env_target = lamb.car(sexpr);
     for (int i=0; i<Nstd_procs; i++) {
-      Sexpr_t sym  = lamb.mk_symbol(std_procs[i].name, env_exec);
-      lamb.gc_root_push(sym);
+      LambRootScope roots(lamb);
+      Sexpr_t sym  = roots.protect(lamb.mk_symbol(std_procs[i].name, env_exec));
       Sexpr_t proc = lamb.mk_Mop3_procst_t(std_procs[i].func, env_exec);
-      lamb.gc_root_pop();
       lamb.dict_bind_bang(env_target, sym, proc, env_exec);
     }
     
@@ -0,0 +1,2536 @@
+#include "LambLisp.h"
+#include "ll_gc.h"
+#include <stdlib.h>
+
+#if LL_POSIX
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+#if LL_GC_WRAP && LL_POSIX
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#endif
+
+/*! @file
+  Tools layered over the LambLisp memory manager.
+
+  The collector itself lives inside the Lamb VM library.
+  The facilities here work from the outside, through the public Lamb interface, to reduce GC pressure and to observe the heap.
+*/
+
+/*
+  LambMemoryManager is opaque outside the VM library.
+  These are the offsets of the fields it logs with each GC cycle: the cell count and free cell count, the mark and sweep quanta, and the Yuasa M and N it derived them from.
+  *blocks* is its table of cell blocks, *Nblocks* long.
+  The collector state is idle, marking, sweeping, or stopped (when collecting only when full).
+  The root stack (for gc_root_push()) is a contiguous array; *cycles* counts the sweeps completed.
+*/
+static const Int_t mm_offset_state       = 0x00;
+static const Int_t mm_offset_blocks      = 0x08;
+static const Int_t mm_offset_Nblocks     = 0x68;
+static const Int_t mm_offset_Nfree       = 0x6c;
+static const Int_t mm_offset_Qm          = 0x94;
+static const Int_t mm_offset_Qs          = 0x98;
+static const Int_t mm_offset_M           = 0x9c;
+static const Int_t mm_offset_N           = 0xa0;
+static const Int_t mm_offset_cycles      = 0x148;
+static const Int_t mm_offset_roots       = 0xc8;
+enum { mm_idle, mm_marking, mm_sweeping, mm_stopped };
+
+static Int_t mm_field(LambMemoryManager *mm, Int_t offset)	{ return *(Int_t *) (((char *) mm) + offset); }
+
+struct MMRootStack { Word_t capacity;  Sexpr_t *roots;  Int_t Nroots; };
+static MMRootStack *mm_root_stack(LambMemoryManager *mm)	{ return (MMRootStack *) (((char *) mm) + mm_offset_roots); }
+
+Lamb *Lamb::_small_int_owner = 0;
+Sexpr_t Lamb::_small_ints[LL_SMALL_INT_MAX - LL_SMALL_INT_MIN + 1];
+Sexpr_t Lamb::_small_chars[256];
+
+/*
+  The shared cells are static, outside the cell blocks, as NIL and #t are.
+  The collector never sweeps them, so no binding or root is needed to keep them, and no Lisp code can release them.
+*/
+static Cell small_int_cells[Lamb::small_int_max - Lamb::small_int_min + 1];
+static Cell small_char_cells[256];
+
+void Lamb::small_ints_install(Sexpr_t env_target, Sexpr_t env_exec)
+{
+  ME("Lamb::small_ints_install()");
+  const Int_t Nsmall = small_int_max - small_int_min + 1;
+  const Int_t Nchars = sizeof(_small_chars) / sizeof(_small_chars[0]);
+
+  for (Int_t i=0; i<Nsmall; i++) {
+    small_int_cells[i].zero();
+    _small_ints[i] = small_int_cells[i].set(small_int_min + i);
+  }
+  for (Int_t i=0; i<Nchars; i++) {
+    small_char_cells[i].zero();
+    _small_chars[i] = small_char_cells[i].set((Char_t) i);
+  }
+  _small_int_owner = this;
+
+  log("%s %d shared integers [%d, %d], %d shared characters\n", me, Nsmall, small_int_min, small_int_max, Nchars);
+}
+
+Sexpr_t *LambCellHandle::table;
+Int_t *LambCellHandle::Nblocks;
+Int_t LambCellHandle::last;
+
+void LambCellHandle::bind(Lamb &lamb)
+{
+#if LL_GC_WRAP
+  table   = (Sexpr_t *) ((char *) lamb.mem + mm_offset_blocks);
+  Nblocks = (Int_t *) ((char *) lamb.mem + mm_offset_Nblocks);
+#else
+  static Int_t no_blocks = 0;	//layout unknown: no cell has a handle
+  Nblocks = &no_blocks;
+#endif
+  if (last >= *Nblocks) last = 0;
+}
+
+static Charst_t cell_type_name(Int_t typ)	{ return ((typ >= 0) && (typ < Cell::Ntypes)) ? Cell::features[typ].type_name : "unknown"; }
+
+void LambHeapWalker::add_vm_roots()
+{
+  const Sexpr_t roots[] = {
+    lamb.lamb_oblist(), lamb.r5_base_environment(), lamb.r5_interaction_environment(),
+    lamb.current_input_port(), lamb.current_output_port(), lamb.current_error_port(),
+    LAMB_INPUT, LAMB_OUTPUT, OBJ_SYSERROR
+  };
+  for (auto r : roots) add_root(r);
+}
+
+Int_t LambHeapWalker::walk(void (*visit)(Sexpr_t c, void *arg), void *arg)
+{
+  Int_t n = 0;
+  while (sp || Nfar) {
+    Sexpr_t c = pop();
+    Int_t typ = c->type();
+    n++;
+    if (visit) visit(c, arg);
+    if (typ >= Cell::T_PAIR) {
+      add_root(c->prechecked_anypair_get_car());
+      add_root(c->prechecked_anypair_get_cdr());
+    }
+    else if (typ <= Cell::T_ANY_HEAP_SVEC) {
+      Int_t Nelems;
+      Sexpr_t *elems;
+      c->any_svec_get_info(Nelems, elems);
+      for (Int_t i=0; i<Nelems; i++) add_root(elems[i]);
+    }
+  }
+  return n;
+}
+
+//(GC.live-cells) => number of cells reachable from the VM roots, counted in a side-table bitmap without disturbing the collector.
+Sexpr_t GC_mop3_live_cells(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  LambHeapWalker walker(lamb);
+  walker.add_vm_roots();
+  walker.walk();
+  return lamb.mk_integer(walker.marks.count(), env_exec);
+}
+
+/*
+  Heap snapshots.
+  A cell is identified by its LambCellHandle, the memory manager's own index, which is -1 outside the blocks.
+*/
+
+static const char snapshot_magic[4] = { 'L', 'L', 'H', 'S' };
+static const Int_t snapshot_counts_at = 12;	//offset of the cell and reference counts, written last
+
+//Size of a cell and of the heap storage it owns.
+static Word_t cell_bytes(Sexpr_t c)
+{
+  Word_t n = sizeof(Cell);
+  switch (c->type()) {
+  case Cell::T_SVEC_HEAP:
+  case Cell::T_SVEC2N_HEAP:	{ Int_t N;  Sexpr_t *e;  c->any_svec_get_info(N, e);  n += N * sizeof(Sexpr_t);  break; }
+  case Cell::T_SYM_HEAP:	{ Int_t h;  Charst_t chars;  c->prechecked_sym_heap_get_info(h, chars);  n += strlen(chars) + 1;  break; }
+  case Cell::T_STR_HEAP:	n += strlen(c->prechecked_str_heap_get_chars()) + 1;  break;
+  case Cell::T_BVEC_HEAP:	{ Int_t N;  ByteVec_t b;  c->any_bvec_get_info(N, b);  n += N;  break; }
+  }
+  return n;
+}
+
+struct SnapshotWriter {
+  LL_File *f;
+  Int_t Ncells;
+  Int_t Nrefs;
+
+  Int_t id(Sexpr_t c)	{ return c ? (Int_t) LambCellHandle::encode(c) : -1; }	//none is -1
+  void put(Int_t w)	{ f->write((const byte *) &w, sizeof(w)); }
+};
+
+static void snapshot_cell(Sexpr_t c, void *arg)
+{
+  SnapshotWriter &w = *(SnapshotWriter *) arg;
+  Int_t id = w.id(c);
+  if (id < 0) return;
+
+  Int_t typ = c->type();
+  Sexpr_t pair[2];
+  Sexpr_t *refs = 0;
+  Int_t Nrefs = 0;
+  if (typ >= Cell::T_PAIR) {
+    pair[0] = c->prechecked_anypair_get_car();
+    pair[1] = c->prechecked_anypair_get_cdr();
+    refs    = pair;
+    Nrefs   = 2;
+  }
+  else if (typ <= Cell::T_ANY_HEAP_SVEC) c->any_svec_get_info(Nrefs, refs);
+
+  Int_t Nout = 0;
+  for (Int_t i=0; i<Nrefs; i++) if (w.id(refs[i]) >= 0) Nout++;
+  w.put(id);
+  w.put(typ);
+  w.put(cell_bytes(c));
+  w.put(Nout);
+  for (Int_t i=0; i<Nrefs; i++) { Int_t r = w.id(refs[i]);  if (r >= 0) w.put(r); }
+  w.Ncells++;
+  w.Nrefs += Nout;
+}
+
+Int_t LambHeapSnapshot::write(Lamb &lamb, const char *path)
+{
+  struct Root { char name[24];  Sexpr_t c; };
+  const Root fixed[] = {
+    { "oblist", lamb.lamb_oblist() }, { "base-environment", lamb.r5_base_environment() }, { "interaction-environment", lamb.r5_interaction_environment() },
+    { "input-port", lamb.current_input_port() }, { "output-port", lamb.current_output_port() }, { "error-port", lamb.current_error_port() },
+    { "LAMB_INPUT", LAMB_INPUT }, { "LAMB_OUTPUT", LAMB_OUTPUT }, { "OBJ_SYSERROR", OBJ_SYSERROR },
+  };
+  const Int_t Nfixed = sizeof(fixed) / sizeof(fixed[0]);
+  Int_t Nstack = 0;
+#if LL_GC_WRAP
+  Nstack = mm_root_stack(lamb.mem)->Nroots;
+#endif
+
+  Root *roots = new Root[Nfixed + Nstack];
+  Int_t Nroots = 0;
+  for (auto r : fixed) roots[Nroots++] = r;
+#if LL_GC_WRAP
+  for (Int_t i=0; i<Nstack; i++) {
+    snprintf(roots[Nroots].name, sizeof(roots[Nroots].name), "root-stack[%d]", i);
+    roots[Nroots++].c = mm_root_stack(lamb.mem)->roots[i];
+  }
+#endif
+
+  LL_File *f = ll_file_system.open(path, "w");
+  if (!f) { delete[] roots;  return -1; }
+
+  SnapshotWriter w = { f, 0, 0 };
+  LambHeapWalker walker(lamb);
+  Int_t Nnamed = 0;
+  for (Int_t i=0; i<Nroots; i++) if (w.id(roots[i].c) >= 0) Nnamed++;
+
+  f->write(snapshot_magic, sizeof(snapshot_magic));
+  w.put(version);
+  w.put(Nnamed);
+  w.put(0);	//cells
+  w.put(0);	//references
+  for (Int_t i=0; i<Nroots; i++) {
+    Int_t id = w.id(roots[i].c);
+    if (id < 0) continue;
+    Int_t len = strlen(roots[i].name);
+    w.put(id);
+    w.put(len);
+    f->write(roots[i].name, len);
+    walker.add_root(roots[i].c);
+  }
+  walker.walk(snapshot_cell, &w);
+
+  f->seek(snapshot_counts_at);
+  w.put(w.Ncells);
+  w.put(w.Nrefs);
+  f->close();
+  delete f;
+  delete[] roots;
+  return w.Ncells;
+}
+
+struct SnapshotReader {
+  LL_File *f;
+  Bool_t ok;
+
+  Int_t get()	{ Int_t w = 0;  if (f->read((byte *) &w, sizeof(w)) != sizeof(w)) ok = false;  return w; }
+};
+
+/*
+  Dominators by the iterative method of Cooper, Harvey and Kennedy, over the nodes in reverse postorder.
+  Node 0 stands above all the roots; the cells are nodes 1 to N.
+*/
+static Int_t dom_intersect(const Int_t *idom, const Int_t *po, Int_t a, Int_t b)
+{
+  while (a != b) {
+    while (po[a] < po[b]) a = idom[a];
+    while (po[b] < po[a]) b = idom[b];
+  }
+  return a;
+}
+
+Int_t LambHeapSnapshot::analyze(const char *path, Retainer *top, Int_t Nmax)
+{
+  LL_File *f = ll_file_system.open(path, "r");
+  if (!f) return -1;
+
+  SnapshotReader r = { f, true };
+  char magic[sizeof(snapshot_magic)];
+  if ((f->read(magic, sizeof(magic)) != sizeof(magic)) || memcmp(magic, snapshot_magic, sizeof(magic)) || (r.get() != version)) {
+    f->close();
+    delete f;
+    return -1;
+  }
+  Int_t Nroots = r.get();
+  Int_t N      = r.get();
+  Int_t Nrefs  = r.get();
+
+  Int_t *root_id = new Int_t[Nroots];
+  char (*root_name)[24] = new char[Nroots][24];
+  for (Int_t i=0; i<Nroots; i++) {
+    root_id[i] = r.get();
+    Int_t len  = r.get();
+    Int_t keep = (len < 23) ? len : 23;
+    f->read(root_name[i], keep);
+    root_name[i][keep] = '\0';
+    for (Int_t j=keep; j<len; j++) f->read();
+  }
+
+  Int_t *id    = new Int_t[N + 1];
+  Int_t *typ   = new Int_t[N + 1];
+  Word_t *size = new Word_t[N + 1];
+  Int_t *first = new Int_t[N + 2];	//references of node v are succ[first[v] .. first[v+1]-1]
+  Int_t *succ  = new Int_t[Nrefs + Nroots];
+  Int_t maxid  = 0;
+
+  id[0] = -1;  typ[0] = -1;  size[0] = 0;
+  first[0] = 0;
+  for (Int_t i=0; i<Nroots; i++) succ[i] = root_id[i];
+  Int_t Nsucc = Nroots;
+  for (Int_t v=1; (v <= N) && r.ok; v++) {
+    id[v]   = r.get();
+    typ[v]  = r.get();
+    size[v] = (Word_t) r.get();
+    Int_t n = r.get();
+    first[v] = Nsucc;
+    for (Int_t k=0; (k < n) && (Nsucc < Nrefs + Nroots); k++) succ[Nsucc++] = r.get();
+    if (id[v] > maxid) maxid = id[v];
+  }
+  first[N + 1] = Nsucc;
+  f->close();
+  delete f;
+
+  //Cell indices to nodes; references to cells not in the snapshot are dropped.
+  Int_t *node = new Int_t[maxid + 1];
+  for (Int_t i=0; i<=maxid; i++) node[i] = -1;
+  for (Int_t v=1; v<=N; v++) if (id[v] >= 0) node[id[v]] = v;
+  for (Int_t k=0; k<Nsucc; k++) succ[k] = ((succ[k] >= 0) && (succ[k] <= maxid)) ? node[succ[k]] : -1;
+
+  //Depth-first from node 0, numbering the nodes in postorder.
+  Int_t *po    = new Int_t[N + 1];
+  Int_t *rpo   = new Int_t[N + 1];
+  Int_t *next  = new Int_t[N + 1];
+  Int_t *stack = new Int_t[N + 1];
+  for (Int_t v=0; v<=N; v++) po[v] = -1;
+  Int_t sp = 0, Nreached = 0;
+  stack[sp++] = 0;
+  next[0]     = first[0];
+  po[0]       = -2;	//on the stack
+  while (sp) {
+    Int_t v = stack[sp - 1];
+    if (next[v] < first[v + 1]) {
+      Int_t u = succ[next[v]++];
+      if ((u > 0) && (po[u] == -1)) { po[u] = -2;  next[u] = first[u];  stack[sp++] = u; }
+    }
+    else {
+      sp--;
+      po[v] = Nreached++;
+    }
+  }
+  for (Int_t v=0; v<=N; v++) if (po[v] >= 0) rpo[Nreached - 1 - po[v]] = v;
+
+  //Predecessors, as a reversed copy of the references among reached nodes.
+  Int_t *pfirst = new Int_t[N + 2];
+  Int_t *pred   = new Int_t[Nsucc];
+  for (Int_t v=0; v<=N+1; v++) pfirst[v] = 0;
+  for (Int_t v=0; v<=N; v++) if (po[v] >= 0) for (Int_t k=first[v]; k<first[v + 1]; k++) if (succ[k] > 0) pfirst[succ[k] + 1]++;
+  for (Int_t v=0; v<=N; v++) pfirst[v + 1] += pfirst[v];
+  for (Int_t v=0; v<=N; v++) next[v] = pfirst[v];
+  for (Int_t v=0; v<=N; v++) if (po[v] >= 0) for (Int_t k=first[v]; k<first[v + 1]; k++) if (succ[k] > 0) pred[next[succ[k]]++] = v;
+
+  Int_t *idom = stack;	//reuse
+  for (Int_t v=0; v<=N; v++) idom[v] = -1;
+  idom[0] = 0;
+  for (Bool_t changed = true; changed; ) {
+    changed = false;
+    for (Int_t k=1; k<Nreached; k++) {
+      Int_t v = rpo[k];
+      Int_t d = -1;
+      for (Int_t j=pfirst[v]; j<pfirst[v + 1]; j++) {
+	Int_t p = pred[j];
+	if (idom[p] < 0) continue;
+	d = (d < 0) ? p : dom_intersect(idom, po, p, d);
+      }
+      if (idom[v] != d) { idom[v] = d;  changed = true; }
+    }
+  }
+
+  //Retained sizes, children before their dominators.
+  Word_t *retained = new Word_t[N + 1];
+  Int_t *Ncells    = next;	//reuse
+  for (Int_t v=0; v<=N; v++) { retained[v] = size[v];  Ncells[v] = 1; }
+  for (Int_t k=Nreached-1; k>0; k--) {
+    Int_t v = rpo[k];
+    retained[idom[v]] += retained[v];
+    Ncells[idom[v]]   += Ncells[v];
+  }
+
+  Int_t Ntop = 0;
+  for (Int_t k=1; k<Nreached; k++) {
+    Int_t v = rpo[k];
+    Int_t j = (Ntop < Nmax) ? Ntop++ : Nmax;
+    for ( ; (j > 0) && (top[j - 1].retained < retained[v]); j--) if (j < Nmax) top[j] = top[j - 1];
+    if (j < Nmax) top[j] = { v, typ[v], retained[v], Ncells[v], "" };	//node number for now, the path is made below
+  }
+
+  for (Int_t t=0; t<Ntop; t++) {
+    Int_t chain[32];
+    Int_t Nchain = 0;
+    Bool_t cut   = false;
+    for (Int_t v=top[t].id; v > 0; v = idom[v]) {
+      if (Nchain == 32) { cut = true;  break; }
+      chain[Nchain++] = v;
+    }
+
+    char *buf = top[t].path;
+    Int_t len = sizeof(top[t].path);
+    Int_t n   = 0;
+    if (cut) n += snprintf(buf + n, len - n, "... > ");
+    else if (Nchain && (idom[chain[Nchain - 1]] == 0)) {
+      Int_t i = 0;
+      while ((i < Nroots) && (root_id[i] != id[chain[Nchain - 1]])) i++;
+      if (i == Nroots) n += snprintf(buf + n, len - n, "<several roots> > ");
+    }
+    for (Int_t i=Nchain-1; (i >= 0) && (n < len); i--) {
+      Int_t v = chain[i];
+      Int_t k = 0;
+      while ((k < Nroots) && (root_id[k] != id[v])) k++;
+      if (k < Nroots) n += snprintf(buf + n, len - n, "%s%s", (i < Nchain - 1) ? " > " : "", root_name[k]);
+      else            n += snprintf(buf + n, len - n, "%s%s#%d", (i < Nchain - 1) ? " > " : "", cell_type_name(typ[v]), id[v]);
+    }
+    top[t].id = id[top[t].id];
+  }
+
+  delete[] root_id;  delete[] root_name;
+  delete[] id;  delete[] typ;  delete[] size;  delete[] first;  delete[] succ;  delete[] node;
+  delete[] po;  delete[] rpo;  delete[] next;  delete[] stack;  delete[] pfirst;  delete[] pred;  delete[] retained;
+  return Ntop;
+}
+
+//(GC.heap-snapshot path) => number of cells written to the snapshot file.
+Sexpr_t GC_mop3_heap_snapshot(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  ME("::GC_mop3_heap_snapshot()");
+  Charst_t path = lamb.car(sexpr)->mustbe_any_str_t()->any_str_get_chars();
+  Int_t n = LambHeapSnapshot::write(lamb, path);
+  if (n < 0) throw lamb.mk_error(env_exec, "%s Cannot write %s", me, path);
+  return lamb.mk_integer(n, env_exec);
+}
+
+/*
+  (GC.heap-analyze path [n]) => the n largest retainers in a snapshot (default 10), largest first, as lists of
+  (retained-bytes retained-cells type retention-path)
+*/
+Sexpr_t GC_mop3_heap_analyze(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  ME("::GC_mop3_heap_analyze()");
+  Charst_t path = lamb.car(sexpr)->mustbe_any_str_t()->any_str_get_chars();
+  Int_t Nmax = (lamb.cdr(sexpr) == NIL) ? 10 : lamb.cadr(sexpr)->mustbe_Int_t();
+  if (Nmax < 1) Nmax = 1;
+
+  LambHeapSnapshot::Retainer *top = new LambHeapSnapshot::Retainer[Nmax];
+  Int_t Ntop = LambHeapSnapshot::analyze(path, top, Nmax);
+  if (Ntop < 0) { delete[] top;  throw lamb.mk_error(env_exec, "%s Not a heap snapshot %s", me, path); }
+
+  Sexpr_t res = NIL;
+  ll_try {
+    for (Int_t i=Ntop-1; i>=0; i--) {
+      LambRootScope roots(lamb);
+      roots.protect(res);
+      Sexpr_t row = NIL;
+      row = roots.protect(lamb.cons(lamb.mk_string(env_exec, "%s", top[i].path), row, env_exec));
+      row = roots.protect(lamb.cons(lamb.mk_symbol(cell_type_name(top[i].typ), env_exec), row, env_exec));
+      row = roots.protect(lamb.cons(lamb.mk_integer(top[i].Ncells, env_exec), row, env_exec));
+      row = roots.protect(lamb.cons(lamb.mk_integer((Int_t) top[i].retained, env_exec), row, env_exec));
+      res = lamb.cons(row, res, env_exec);
+    }
+  }
+  catch (Sexpr_t err) { delete[] top;  throw err; }
+  delete[] top;
+  return res;
+}
+
+void LambHeapCensus::take(Lamb &lamb)
+{
+  Int_t t0 = micros();
+  LambCellHandle::bind(lamb);
+  memset(cells, 0, sizeof(cells));
+  memset(bytes, 0, sizeof(bytes));
+  Nfree = Nissued = 0;
+  if (Nblocks != LambCellHandle::blocks()) {
+    delete[] block;
+    Nblocks = LambCellHandle::blocks();
+    block   = new Block[Nblocks];
+  }
+
+  for (Int_t b=0; b<Nblocks; b++) {
+    Sexpr_t c = LambCellHandle::block(b);
+    Block &blk = block[b];
+    Int_t run = 0;
+    blk.free = blk.issued = blk.runs = blk.longest = 0;
+    for (Int_t i=0; i<LambCellHandle::cells_per_block; i++, c++) {
+      Int_t st = c->gc_state();
+      if (st == Cell::gcst_free) {
+	if (!run++) blk.runs++;
+	if (run > blk.longest) blk.longest = run;
+	blk.free++;
+	continue;
+      }
+      run = 0;
+      if (st == Cell::gcst_issued) blk.issued++;
+      Int_t typ = c->type();
+      if ((typ < 0) || (typ >= Cell::Ntypes)) continue;
+      cells[typ]++;
+      bytes[typ] += cell_bytes(c) - sizeof(Cell);
+    }
+    Nfree   += blk.free;
+    Nissued += blk.issued;
+  }
+  us = micros() - t0;
+}
+
+void ll_mm_gc_pass(LambMemoryManager *mm, Sexpr_t env_exec) asm("_ZN17LambMemoryManager7gc_passEP4Cell");
+
+LambGCPacer lambGCPacer;
+
+#if LL_GC_WRAP
+/*
+  The VM library calls LambMemoryManager::gc_idle_task_us() from Lamb::loop().
+  Linking with --wrap on its mangled name routes that call here, and the original remains reachable as __real_.
+*/
+void ll_gc_idle_task_us_real(LambMemoryManager *mm, Int_t us, Sexpr_t env_exec) asm("__real__ZN17LambMemoryManager15gc_idle_task_usEiP4Cell");
+void ll_gc_idle_task_us_wrap(LambMemoryManager *mm, Int_t us, Sexpr_t env_exec) asm("__wrap__ZN17LambMemoryManager15gc_idle_task_usEiP4Cell");
+
+void ll_gc_idle_task_us_wrap(LambMemoryManager *mm, Int_t us, Sexpr_t env_exec)
+{
+  lambGCPacer.idle_calls++;
+  if (lambGCPacer.pacing == LambGCPacer::pace_demand) return;
+
+  Int_t want = us;
+  if (lambGCPacer.pacing == LambGCPacer::pace_deadline) {
+    us = lambGCPacer.deadline_quantum(lambPlatform.loop_elapsed_us(), want);
+    if (!us) { lambGCPacer.deadline_skips++;  return; }
+  }
+
+  Int_t t0 = micros();
+  ll_gc_idle_task_us_real(mm, us, env_exec);
+  Int_t dt = micros() - t0;
+  lambGCTelemetry.observe();
+  if (lambGCPacer.pacing == LambGCPacer::pace_deadline) lambGCPacer.deadline_account(us, want, dt);
+
+  lambGCPacer.idle_runs++;
+  lambGCPacer.idle_us += dt;
+  if (dt > lambGCPacer.idle_us_max) lambGCPacer.idle_us_max = dt;
+}
+
+/*
+  Both cell constructors, called by Lamb::tcons(), are interposed for the telemetry and the allocation profiler.
+  Allocation is the other place the collector runs: when free cells run short, tcons() runs GC quanta before returning.
+*/
+Sexpr_t ll_tcons_words_real(LambMemoryManager *mm, Int_t typ, Word_t a, Word_t b, Sexpr_t env_exec) asm("__real__ZN17LambMemoryManager5tconsEimmP4Cell");
+Sexpr_t ll_tcons_words_wrap(LambMemoryManager *mm, Int_t typ, Word_t a, Word_t b, Sexpr_t env_exec) asm("__wrap__ZN17LambMemoryManager5tconsEimmP4Cell");
+Sexpr_t ll_tcons_cells_real(LambMemoryManager *mm, Int_t typ, Sexpr_t a, Sexpr_t b, Sexpr_t env_exec) asm("__real__ZN17LambMemoryManager5tconsEiP4CellS1_S1_");
+Sexpr_t ll_tcons_cells_wrap(LambMemoryManager *mm, Int_t typ, Sexpr_t a, Sexpr_t b, Sexpr_t env_exec) asm("__wrap__ZN17LambMemoryManager5tconsEiP4CellS1_S1_");
+
+Sexpr_t ll_tcons_words_wrap(LambMemoryManager *mm, Int_t typ, Word_t a, Word_t b, Sexpr_t env_exec)
+{
+  lambGCTelemetry.alloc(mm);
+  lambAllocProfiler.tick(typ, env_exec);
+  Sexpr_t c = ll_tcons_words_real(mm, typ, a, b, env_exec);
+  LambAllocScope::allocated(c);
+  lambGCTelemetry.observe();
+  return c;
+}
+
+Sexpr_t ll_tcons_cells_wrap(LambMemoryManager *mm, Int_t typ, Sexpr_t a, Sexpr_t b, Sexpr_t env_exec)
+{
+  lambGCTelemetry.alloc(mm);
+  lambAllocProfiler.tick(typ, env_exec);
+  Sexpr_t c = ll_tcons_cells_real(mm, typ, a, b, env_exec);
+  LambAllocScope::allocated(c);
+  lambGCTelemetry.observe();
+  return c;
+}
+
+/*
+  The block timers in the VM library, in the order of the telemetry phases.
+  Each holds the number of intervals timed and their total time since the timer was last reset, which the library does at every reporting window.
+*/
+struct LambBlockTimer { uint64_t count;  uint64_t window;  uint64_t start;  uint64_t accum; };
+namespace GCTimer_mark		{ extern LambBlockTimer GCTimer_mark_bt; }
+namespace GCTimer_sweep		{ extern LambBlockTimer GCTimer_sweep_bt; }
+namespace GCTimer_pass		{ extern LambBlockTimer GCTimer_pass_bt; }
+namespace GC_stop_timer		{ extern LambBlockTimer GC_stop_timer_bt; }
+namespace DictRefTimer_us	{ extern LambBlockTimer DictRefTimer_us_bt; }
+
+static LambBlockTimer *const gc_timers[LambGCTelemetry::Nphases] = {
+  &GCTimer_mark::GCTimer_mark_bt, &GCTimer_sweep::GCTimer_sweep_bt, &GCTimer_pass::GCTimer_pass_bt, &GC_stop_timer::GC_stop_timer_bt
+};
+
+LambGCTelemetry lambGCTelemetry;
+
+void LambGCTelemetry::reset()
+{
+  for (Int_t ph=0; ph<Nphases; ph++) {
+    pause[ph].reset();
+    seen[ph].count  = gc_timers[ph]->count;
+    seen[ph].window = gc_timers[ph]->window;
+    seen[ph].accum  = gc_timers[ph]->accum;
+  }
+  loop_allocs.reset();
+  allocs          = 0;
+  Nexpand_events  = 0;
+  seen_loop       = lambPlatform.loop_count();
+  loop_allocs_now = 0;
+  seen_blocks     = mm ? mm_field(mm, mm_offset_Nblocks) : 0;	//as observe() counts them
+}
+
+void LambGCTelemetry::loop_close()
+{
+  Word_t loop = lambPlatform.loop_count();
+  if (loop > seen_loop + 1) loop_allocs.add(0, loop - seen_loop - 1);	//the loops in between allocated nothing
+  if (loop > seen_loop) loop_allocs.add(loop_allocs_now);
+  loop_allocs_now = 0;
+  seen_loop       = loop;
+}
+
+void LambGCTelemetry::observe()
+{
+  Int_t blocks = mm ? mm_field(mm, mm_offset_Nblocks) : 0;
+  if (blocks != seen_blocks) {
+    if (blocks > seen_blocks) {
+      Int_t ix = Nexpand_events++ % Nexpands;
+      expands[ix].ms     = millis();
+      expands[ix].blocks = blocks;
+    }
+    seen_blocks = blocks;
+  }
+
+  //Every quantum runs inside a GC pass, so nothing else can have changed if the pass timer has not.
+  const LambBlockTimer *pass = gc_timers[ph_pass];
+  if ((pass->count == seen[ph_pass].count) && (pass->window == seen[ph_pass].window)) return;
+
+  for (Int_t ph=0; ph<Nphases; ph++) {
+    const LambBlockTimer *t = gc_timers[ph];
+    Seen &s      = seen[ph];
+    uint64_t dn  = t->count;
+    uint64_t dus = t->accum;
+    if (t->window == s.window) { dn -= s.count;  dus -= s.accum; }
+    if (dn) pause[ph].add(dus);
+    s.count  = t->count;
+    s.window = t->window;
+    s.accum  = t->accum;
+  }
+}
+
+Bool_t LambGCTelemetry::yuasa(Int_t v[Nyuasa])
+{
+  static const Int_t offsets[Nyuasa] = { mm_offset_Nblocks, mm_offset_Nfree, mm_offset_Qm, mm_offset_Qs, mm_offset_M, mm_offset_N };
+  if (!mm) return false;
+  for (Int_t i=0; i<Nyuasa; i++) v[i] = mm_field(mm, offsets[i]);
+  v[0] *= LambCellArena::cells_per_block;
+  return true;
+}
+
+LambAllocProfiler lambAllocProfiler;
+
+void LambAllocProfiler::start(Int_t p)
+{
+  period  = (p > 0) ? p : 0;
+  running = (period > 0);
+  clear();
+#if LL_POSIX
+  void *pcs[2];
+  backtrace(pcs, 2);	//the first call loads the unwinder, which must not happen inside an allocation
+#endif
+}
+
+void LambAllocProfiler::sample(Int_t typ, Sexpr_t env_exec)
+{
+  Site s;
+  memset(&s, 0, sizeof(s));
+  s.typ = typ;
+
+  //The top frame of an environment built for a procedure call or let is an alist of (variable . value), latest binding first.
+  if (env_exec && (env_exec->type() == Cell::T_DICT)) {
+    Sexpr_t frame = env_exec->prechecked_anypair_get_car();
+    if (frame && (frame->type() == Cell::T_PAIR)) {
+      Sexpr_t kv;
+      while (frame && (frame->type() == Cell::T_PAIR) && (kv = frame->prechecked_anypair_get_car()) && (kv->type() == Cell::T_PAIR)) {
+	if (s.Nvars < Nkeys) s.keys[s.Nvars] = kv->prechecked_anypair_get_car();
+	s.Nvars++;
+	frame = frame->prechecked_anypair_get_cdr();
+      }
+    }
+    else if (frame != NIL) s.Nvars = -1;	//hashed frame, as in the interaction environment
+  }
+
+#if LL_POSIX
+  void *pcs[Npcs + 1];
+  Int_t n = backtrace(pcs, Npcs + 1);
+  for (Int_t i=1; i<n; i++) s.pcs[i - 1] = pcs[i];	//not this function
+#endif
+
+  Word_t h = typ * 31 + s.Nvars;
+  for (Int_t i=0; i<Nkeys; i++) h = (h * 1000003) ^ (Word_t) s.keys[i];
+  for (Int_t i=0; i<Npcs; i++)  h = (h * 1000003) ^ (Word_t) s.pcs[i];
+
+  Nsamples++;
+  const size_t keylen = sizeof(Site) - offsetof(Site, typ);
+  for (Word_t ix = h % Nsites; ; ix = (ix + 1) % Nsites) {
+    Site &t = sites[ix];
+    if (t.samples && memcmp(&t.typ, &s.typ, keylen)) continue;
+    if (!t.samples) {
+      if (4 * (Nused + 1) > 3 * Nsites) { overflow++;  return; }
+      Nused++;
+      t = s;
+    }
+    t.samples++;
+    return;
+  }
+}
+
+//Return true if *proc* is a procedure whose formals are exactly the sampled variables.
+static bool formals_match(Sexpr_t proc, Int_t Nvars, const Sexpr_t *keys)
+{
+  const Int_t Nkeys = LambAllocProfiler::Nkeys;
+  if (proc->type() != Cell::T_PROC) return false;
+
+  Sexpr_t formals = proc->prechecked_anypair_get_car()->prechecked_anypair_get_car();
+  Int_t Nformals  = 0;
+  Int_t Nfound    = 0;
+  while (formals != NIL) {
+    Sexpr_t f = (formals->type() == Cell::T_PAIR) ? formals->prechecked_anypair_get_car() : formals;	//dotted or symbol formals end in a rest variable
+    Nformals++;
+    for (Int_t i=0; i<Nvars && i<Nkeys; i++) if (keys[i] == f) { Nfound++;  break; }
+    formals = (formals->type() == Cell::T_PAIR) ? formals->prechecked_anypair_get_cdr() : NIL;
+  }
+  return (Nformals == Nvars) && (Nfound == ((Nvars < Nkeys) ? Nvars : Nkeys));
+}
+
+//Name a sampled environment by the top-level procedures whose formals match its variables.
+static void lisp_site_name(Int_t Nvars, const Sexpr_t *keys, Sexpr_t frame, char *buf, Int_t len)
+{
+  const Int_t Nkeys = LambAllocProfiler::Nkeys;
+  if (Nvars < 0)  { snprintf(buf, len, "<top level>");  return; }
+  if (Nvars == 0) { snprintf(buf, len, "<no locals>");  return; }
+
+  //The interaction environment frame is a hash table of buckets, each an alist of (symbol . value).
+  Int_t Nbuckets;
+  Sexpr_t *buckets;
+  frame->any_svec_get_info(Nbuckets, buckets);
+
+  Int_t n = 0;
+  buf[0] = '\0';
+  for (Int_t ix=0; ix<Nbuckets; ix++) {
+    for (Sexpr_t b = buckets[ix]; b->type() == Cell::T_PAIR; b = b->prechecked_anypair_get_cdr()) {
+      Sexpr_t kv = b->prechecked_anypair_get_car();
+      if ((kv->type() != Cell::T_PAIR) || !formals_match(kv->prechecked_anypair_get_cdr(), Nvars, keys)) continue;
+      if (n < len) n += snprintf(buf + n, len - n, "%s%s", n ? "|" : "", kv->prechecked_anypair_get_car()->str().c_str());
+    }
+  }
+  if (n) return;
+
+  n = snprintf(buf, len, "(lambda/let");
+  for (Int_t i=((Nvars < Nkeys) ? Nvars : Nkeys) - 1; (i >= 0) && (n < len); i--) n += snprintf(buf + n, len - n, " %s", keys[i]->str().c_str());
+  if (n < len) snprintf(buf + n, len - n, "%s)", (Nvars > Nkeys) ? " ..." : "");
+}
+
+//Name the first native function that is not part of the allocator itself.
+static void native_site_name(void *const *pcs, char *buf, Int_t len)
+{
+  static const char *allocators[] = { "__wrap_", "ll_tcons", "LambAllocProfiler::", "Lamb::tcons", "Lamb::cons", "Lamb::mk_", "LambMemoryManager::" };
+  buf[0] = '\0';
+#if LL_POSIX
+  for (Int_t i=0; (i < LambAllocProfiler::Npcs) && pcs[i]; i++) {
+    Dl_info info;
+    if (!dladdr(pcs[i], &info) || !info.dli_sname) { snprintf(buf, len, "%p", pcs[i]);  return; }
+
+    int status;
+    char *name = abi::__cxa_demangle(info.dli_sname, 0, 0, &status);
+    const char *nm = name ? name : info.dli_sname;
+    bool skip = false;
+    for (auto a : allocators) if (!strncmp(nm, a, strlen(a))) skip = true;
+    if (!skip) {
+      snprintf(buf, len, "%s", nm);
+      char *paren = strchr(buf, '(');
+      if (paren) *paren = '\0';
+    }
+    free(name);
+    if (!skip) return;
+  }
+#endif
+}
+
+Int_t LambAllocProfiler::report(Lamb &lamb, Row *rows, Int_t Nmax)
+{
+  Sexpr_t frame = lamb.r5_interaction_environment()->prechecked_anypair_get_car();
+
+  Int_t Nrows = 0;
+  for (Int_t ix=0; ix<Nsites; ix++) {
+    Site &t = sites[ix];
+    if (!t.samples) continue;
+
+    Row r;
+    r.samples = t.samples;
+    r.typ     = t.typ;
+    lisp_site_name(t.Nvars, t.keys, frame, r.lisp, sizeof(r.lisp));
+    native_site_name(t.pcs, r.native, sizeof(r.native));
+
+    Int_t i = 0;
+    while ((i < Nrows) && ((rows[i].typ != r.typ) || strcmp(rows[i].lisp, r.lisp) || strcmp(rows[i].native, r.native))) i++;
+    if (i < Nrows) rows[i].samples += r.samples;
+    else if (Nrows < Nmax) rows[Nrows++] = r;
+  }
+
+  for (Int_t i=1; i<Nrows; i++) {	//insertion sort, largest first
+    Row r = rows[i];
+    Int_t j = i;
+    for ( ; (j > 0) && (rows[j - 1].samples < r.samples); j--) rows[j] = rows[j - 1];
+    rows[j] = r;
+  }
+  return Nrows;
+}
+
+//Append formatted text to an open file, counting the bytes.
+static void json_printf(LL_File *f, Int_t &nbytes, const char *fmt, ...)
+{
+  char buf[256];
+  va_list args;
+  va_start(args, fmt);
+  Int_t n = vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  if (n > (Int_t) sizeof(buf) - 1) n = sizeof(buf) - 1;
+  f->write(buf, n);
+  nbytes += n;
+}
+
+static void json_histogram(LL_File *f, Int_t &nbytes, const char *name, LambHistogram &h, const char *sep)
+{
+  json_printf(f, nbytes, "    \"%s\": { \"count\": %llu, \"total\": %llu, \"p50\": %llu, \"p99\": %llu, \"max\": %llu }%s\n",
+	      name, (unsigned long long) h.count, (unsigned long long) h.total,
+	      (unsigned long long) h.percentile(50), (unsigned long long) h.percentile(99), (unsigned long long) h.max, sep);
+}
+
+Int_t LambGCTelemetry::dump_json(const char *path)
+{
+  LL_File *f = ll_file_system.open(path, "w");
+  if (!f) return -1;
+
+  Int_t n = 0;
+  json_printf(f, n, "{\n  \"ms\": %lu,\n  \"loops\": %lu,\n  \"allocs\": %llu,\n", (unsigned long) millis(), (unsigned long) lambPlatform.loop_count(), (unsigned long long) allocs);
+  json_printf(f, n, "  \"loop_allocs\": {\n");
+  json_histogram(f, n, "cells", loop_allocs, "");
+  json_printf(f, n, "  },\n  \"pause_us\": {\n");
+  for (Int_t ph=0; ph<Nphases; ph++) json_histogram(f, n, phase_name(ph), pause[ph], (ph < Nphases - 1) ? "," : "");
+  json_printf(f, n, "  },\n  \"expands\": { \"events\": %lu, \"recent\": [", (unsigned long) Nexpand_events);
+  Word_t first = (Nexpand_events > (Word_t) Nexpands) ? Nexpand_events - Nexpands : 0;
+  for (Word_t e=first; e<Nexpand_events; e++)
+    json_printf(f, n, "%s{ \"ms\": %d, \"blocks\": %d }", (e > first) ? ", " : " ", expands[e % Nexpands].ms, expands[e % Nexpands].blocks);
+  json_printf(f, n, " ] },\n");
+  Int_t y[Nyuasa];
+  if (yuasa(y)) json_printf(f, n, "  \"yuasa\": { \"cells\": %d, \"free\": %d, \"Qm\": %d, \"Qs\": %d, \"M\": %d, \"N\": %d },\n", y[0], y[1], y[2], y[3], y[4], y[5]);
+  json_printf(f, n, "  \"dict_ref\": { \"count\": %llu, \"us\": %llu }\n}\n",
+	      (unsigned long long) DictRefTimer_us::DictRefTimer_us_bt.count, (unsigned long long) DictRefTimer_us::DictRefTimer_us_bt.accum);
+  f->close();
+  delete f;
+  return n;
+}
+#endif
+
+#if LL_GC_WRAP
+/*
+  Heap sizing.
+  The memory manager's expand() adds one block, or logs and does nothing if LambPlatform::free_heap() is short or its block table is full.
+*/
+void ll_mm_expand(LambMemoryManager *mm) asm("_ZN17LambMemoryManager6expandEv");
+
+
+Int_t LambHeapPolicy::initial_blocks = 1;
+Int_t LambHeapPolicy::max_blocks     = LambHeapPolicy::vm_max_blocks;
+Int_t LambHeapPolicy::growth_pct     = 100;
+Bool_t LambHeapPolicy::lock          = false;
+Bool_t LambHeapPolicy::locked        = false;
+Word_t LambHeapPolicy::vm_expands;
+Word_t LambHeapPolicy::policy_expands;
+
+static LambMemoryManager *policy_mm;
+static Int_t policy_seen, policy_target;
+
+void LambHeapPolicy::configure(Int_t initial, Int_t max, Int_t pct, Bool_t l)
+{
+  max_blocks     = (max < 1) ? 1 : (max > vm_max_blocks) ? vm_max_blocks : max;
+  initial_blocks = (initial < 1) ? 1 : (initial > max_blocks) ? max_blocks : initial;
+  growth_pct     = (pct < 100) ? 100 : pct;
+  lock           = l;
+  if (policy_target < initial_blocks) policy_target = initial_blocks;
+}
+
+void LambHeapPolicy::setup()
+{
+#if LL_POSIX
+  ME("LambHeapPolicy::setup()");
+  Int_t initial = initial_blocks, max = max_blocks, pct = growth_pct;
+  Bool_t l = lock;
+  const char *s;
+  if ((s = getenv("LAMB_HEAP_BLOCKS")))     initial = atoi(s);
+  if ((s = getenv("LAMB_HEAP_MAX_BLOCKS"))) max     = atoi(s);
+  if ((s = getenv("LAMB_HEAP_GROWTH_PCT"))) pct     = atoi(s);
+  if ((s = getenv("LAMB_HEAP_LOCK")))       l       = atoi(s) != 0;
+  configure(initial, max, pct, l);
+  global_printf("%s %d initial blocks, at most %d, growth %d%%%s\n", me, initial_blocks, max_blocks, growth_pct, lock ? ", locked" : "");
+#endif
+}
+
+Int_t LambHeapPolicy::blocks()	{ return policy_mm ? mm_field(policy_mm, mm_offset_Nblocks) : 0; }
+Bool_t LambHeapPolicy::full()	{ return policy_mm && (blocks() >= max_blocks); }
+
+//Add blocks up to the target, where the memory manager would add them itself: outside the mark phase.
+static void policy_expand()
+{
+  Int_t st = mm_field(policy_mm, mm_offset_state);
+  if ((st != mm_idle) && (st != mm_sweeping)) return;
+  for (Int_t n = LambHeapPolicy::blocks(); n < policy_target; n++) {
+    ll_mm_expand(policy_mm);
+    if (LambHeapPolicy::blocks() == n) break;	//refused
+    LambHeapPolicy::policy_expands++;
+  }
+  policy_seen = LambHeapPolicy::blocks();
+  lambGCTelemetry.observe();
+}
+
+void LambHeapPolicy::apply(Lamb &lamb)
+{
+  ME("LambHeapPolicy::apply()");
+  policy_mm   = lamb.mem;
+  policy_seen = blocks();
+  if (policy_target < initial_blocks) policy_target = initial_blocks;
+  if (policy_target > max_blocks) policy_target = max_blocks;
+  policy_expand();
+#if LL_POSIX
+  if (lock && !locked) {
+    locked = (mlockall(MCL_CURRENT | MCL_FUTURE) == 0);
+    if (!locked) lamb.log("%s mlockall() failed: %s\n", me, strerror(errno));
+  }
+#endif
+  lamb.log("%s %d blocks, %d cells%s\n", me, blocks(), blocks() * LambCellArena::cells_per_block, locked ? ", memory locked" : "");
+}
+
+void LambHeapPolicy::idle(Lamb &lamb)
+{
+  if (!policy_mm) return;
+  Int_t n = blocks();
+  if (n > policy_seen) {
+    vm_expands += n - policy_seen;
+    Int_t want = (policy_seen * growth_pct + 99) / 100;
+    if (want < n) want = n;
+    if (want > max_blocks) want = max_blocks;
+    if (policy_target < want) policy_target = want;
+    policy_seen = n;
+  }
+  if (n < policy_target) policy_expand();
+}
+#endif
+
+/*
+  The finalizer queue is a ring of (deleter, object) pairs.
+  On POSIX it is shared with the worker pool under a mutex; elsewhere only the VM thread touches it.
+*/
+struct FinEntry { CPPDeleterPtr d;  void *obj; };
+static FinEntry fin_queue[LambFinalizer::Nqueue];
+static Int_t fin_head, fin_depth, fin_depth_max;
+static Word_t fin_queued, fin_run, fin_inline;
+
+#if LL_POSIX
+static pthread_mutex_t fin_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  fin_cond = PTHREAD_COND_INITIALIZER;
+static Int_t fin_workers, fin_workers_wanted;
+#define FIN_LOCK()	pthread_mutex_lock(&fin_lock)
+#define FIN_UNLOCK()	pthread_mutex_unlock(&fin_lock)
+#else
+#define FIN_LOCK()
+#define FIN_UNLOCK()
+#endif
+
+//Take up to max entries from the head of the queue; call with the lock held.
+static Int_t fin_take(FinEntry *out, Int_t max)
+{
+  Int_t n = 0;
+  while ((n < max) && fin_depth) {
+    out[n++] = fin_queue[fin_head];
+    fin_head = (fin_head + 1) % LambFinalizer::Nqueue;
+    fin_depth--;
+  }
+  fin_run += n;
+  return n;
+}
+
+void LambFinalizer::defer(CPPDeleterPtr d, void *obj)
+{
+  FIN_LOCK();
+  if (fin_depth == Nqueue) {
+    fin_inline++;
+    FIN_UNLOCK();
+    if (!worker_running()) drain();	//keep the order when the queue is run here
+    d(obj);
+    return;
+  }
+  fin_queue[(fin_head + fin_depth) % Nqueue] = { d, obj };
+  if (++fin_depth > fin_depth_max) fin_depth_max = fin_depth;
+  fin_queued++;
+#if LL_POSIX
+  pthread_cond_signal(&fin_cond);
+#endif
+  FIN_UNLOCK();
+}
+
+Int_t LambFinalizer::drain(Int_t max)
+{
+  FinEntry e[batch];
+  Int_t n = 0;
+  while (n < max) {
+    FIN_LOCK();
+    Int_t k = fin_take(e, (max - n < batch) ? max - n : batch);
+    FIN_UNLOCK();
+    if (!k) break;
+    for (Int_t i=0; i<k; i++) e[i].d(e[i].obj);
+    n += k;
+  }
+  return n;
+}
+
+#if LL_POSIX
+//A worker takes an even share of what is queued, so that a burst is spread over the pool; it leaves when the pool is shrunk.
+static void *fin_worker_main(void *)
+{
+  FinEntry e[LambFinalizer::batch];
+  while (true) {
+    FIN_LOCK();
+    while (!fin_depth && (fin_workers <= fin_workers_wanted)) pthread_cond_wait(&fin_cond, &fin_lock);
+    if (fin_workers > fin_workers_wanted) {
+      fin_workers--;
+      FIN_UNLOCK();
+      return 0;
+    }
+    Int_t share = fin_depth / fin_workers;
+    if (share < 1) share = 1;
+    if (share > LambFinalizer::batch) share = LambFinalizer::batch;
+    Int_t k = fin_take(e, share);
+    if (fin_depth) pthread_cond_signal(&fin_cond);
+    FIN_UNLOCK();
+    for (Int_t i=0; i<k; i++) e[i].d(e[i].obj);
+  }
+  return 0;
+}
+#endif
+
+void LambFinalizer::start_worker()
+{
+#if LL_POSIX
+  const char *v = getenv("LAMB_FINALIZER_THREADS");
+  if (v) set_workers(atoi(v));
+#endif
+}
+
+void LambFinalizer::set_workers(Int_t n)
+{
+#if LL_POSIX
+  if (n < 0) n = 0;
+  if (n > Nworkers_max) n = Nworkers_max;
+  FIN_LOCK();
+  fin_workers_wanted = n;
+  while (fin_workers < fin_workers_wanted) {
+    pthread_t t;
+    if (pthread_create(&t, 0, fin_worker_main, 0)) break;
+    pthread_detach(t);
+    fin_workers++;
+  }
+  pthread_cond_broadcast(&fin_cond);	//surplus workers leave
+  FIN_UNLOCK();
+#endif
+}
+
+Int_t LambFinalizer::workers()
+{
+#if LL_POSIX
+  return fin_workers;
+#else
+  return 0;
+#endif
+}
+
+void LambFinalizer::stats(Word_t &queued, Word_t &run, Word_t &inline_run, Int_t &depth, Int_t &depth_max)
+{
+  FIN_LOCK();
+  queued     = fin_queued;
+  run        = fin_run;
+  inline_run = fin_inline;
+  depth      = fin_depth;
+  depth_max  = fin_depth_max;
+  FIN_UNLOCK();
+}
+
+/*
+  Weak references.
+  Registry element i holds the target of weak box i, or the bucket vector of ephemeron table i; each bucket is a list of (key . value) entries.
+  Cells outside the cell blocks (NIL, #t, #f ...) are never collected, so references to them never break.
+*/
+enum { weak_free, weak_box, weak_table };
+struct WeakSlot { Int_t kind;  volatile Bool_t dead;  Bool_t broken;  Int_t index;  Sexpr_t holder; };
+
+/*
+  The slots are allocated in chunks that never move, because each holder's deleter keeps a pointer to its slot.
+  The registry vector is replaced by one twice the size when the slots run out.
+*/
+static const Int_t weak_chunk = 256;
+static WeakSlot **weak_chunks;
+static Int_t weak_Nslots, weak_used, weak_hint;
+static Sexpr_t weak_registry, weak_env;
+static Word_t weak_sweeps, weak_broken, weak_last_us, weak_last_ms;
+#if LL_GC_WRAP
+static Int_t weak_last_cycle = -1;	//the library's cycle count at the last sweep
+#endif
+Word_t LambWeak::interval_ms = 100;
+
+static WeakSlot &weak_slot_at(Int_t i)	{ return weak_chunks[i / weak_chunk][i % weak_chunk]; }
+static void weak_release(void *obj)	{ ((WeakSlot *) obj)->dead = true; }	//deleter, run in the library's sweep
+
+static WeakSlot *weak_slot(Sexpr_t c, Int_t kind)
+{
+  if ((c->type() != Cell::T_CPP_HEAP) || (c->prechecked_cppobj_get_deleter() != weak_release)) return 0;
+  WeakSlot *s = (WeakSlot *) c->prechecked_cppobj_get_ptr();
+  return (s->kind == kind) ? s : 0;
+}
+
+static Sexpr_t weak_ref(Int_t i)	{ Int_t N;  Sexpr_t *e;  weak_registry->any_svec_get_info(N, e);  return e[i]; }
+static Int_t weak_hash(Sexpr_t key, Int_t N)	{ return (((Word_t) key) / sizeof(Cell)) & (N - 1); }
+
+
+//Free the slots whose holders the library has swept, releasing what they referred to.
+static void weak_reclaim(Lamb &lamb)
+{
+  for (Int_t i=0; i<weak_Nslots; i++) {
+    WeakSlot &s = weak_slot_at(i);
+    if ((s.kind == weak_free) || !s.dead) continue;
+    lamb.vector_set_bang(weak_registry, i, NIL);
+    s = { weak_free, false, false, i, 0 };
+    weak_used--;
+  }
+}
+
+static void weak_grow(Lamb &lamb, Sexpr_t env_exec)
+{
+  Int_t N = weak_Nslots ? 2 * weak_Nslots : weak_chunk;
+  LambRootScope roots(lamb);
+  Sexpr_t vec = roots.protect(lamb.mk_vector(N, NIL, env_exec));
+  Sexpr_t sym = roots.protect(lamb.mk_symbol("%GC.weak-registry", env_exec));
+  for (Int_t i=0; i<weak_Nslots; i++) lamb.vector_set_bang(vec, i, weak_ref(i));
+  lamb.dict_bind_bang(weak_env, sym, vec, env_exec);
+  weak_registry = vec;
+
+  WeakSlot **chunks = new WeakSlot *[N / weak_chunk];
+  for (Int_t c=0; c<N/weak_chunk; c++) {
+    if (c < weak_Nslots / weak_chunk) { chunks[c] = weak_chunks[c];  continue; }
+    chunks[c] = new WeakSlot[weak_chunk];
+    for (Int_t j=0; j<weak_chunk; j++) chunks[c][j] = { weak_free, false, false, c * weak_chunk + j, 0 };
+  }
+  delete[] weak_chunks;
+  weak_chunks = chunks;
+  weak_hint   = weak_Nslots;
+  weak_Nslots = N;
+}
+
+static Sexpr_t weak_alloc(Lamb &lamb, Int_t kind, Sexpr_t ref, Sexpr_t env_exec)
+{
+  ME("::weak_alloc()");
+  if (!weak_registry) throw lamb.mk_error(env_exec, "%s No weak registry, GC.install-mop3 has not run", me);
+  LambRootScope roots(lamb);
+  roots.protect(ref);
+  if (weak_used == weak_Nslots) weak_reclaim(lamb);
+  if (weak_used == weak_Nslots) weak_grow(lamb, env_exec);
+
+  Int_t i = weak_hint;
+  while (weak_slot_at(i).kind != weak_free) i = (i + 1) % weak_Nslots;
+  weak_hint = (i + 1) % weak_Nslots;
+
+  WeakSlot &s    = weak_slot_at(i);
+  Sexpr_t holder = lamb.mk_cppobj(&s, weak_release, env_exec);
+  lamb.vector_set_bang(weak_registry, i, ref);
+  s = { kind, false, false, i, holder };
+  weak_used++;
+  return holder;
+}
+
+void LambWeak::install(Lamb &lamb, Sexpr_t env_target, Sexpr_t env_exec)
+{
+  if (weak_registry) return;
+  weak_env = env_target;
+  weak_grow(lamb, env_exec);
+}
+
+Sexpr_t LambWeak::mk_weak_box(Lamb &lamb, Sexpr_t target, Sexpr_t env_exec)	{ return weak_alloc(lamb, weak_box, target, env_exec); }
+Bool_t LambWeak::is_weak_box(Sexpr_t c)						{ return weak_slot(c, weak_box) != 0; }
+
+Sexpr_t LambWeak::weak_box_ref(Sexpr_t box, Sexpr_t dflt)
+{
+  WeakSlot *s = weak_slot(box, weak_box);
+  return s->broken ? dflt : weak_ref(s->index);
+}
+
+Sexpr_t LambWeak::mk_ephemeron_table(Lamb &lamb, Int_t Nbuckets, Sexpr_t env_exec)
+{
+  Int_t N = 1;
+  while (N < Nbuckets) N *= 2;
+  LambRootScope roots(lamb);
+  Sexpr_t buckets = roots.protect(lamb.mk_vector(N, NIL, env_exec));
+  return weak_alloc(lamb, weak_table, buckets, env_exec);
+}
+
+Bool_t LambWeak::is_ephemeron_table(Sexpr_t c)	{ return weak_slot(c, weak_table) != 0; }
+
+//The bucket of *key* in a table, and the entry for it, or NIL.
+static Sexpr_t weak_find(Sexpr_t table, Sexpr_t key, Sexpr_t &buckets, Int_t &h)
+{
+  buckets = weak_ref(weak_slot(table, weak_table)->index);
+  Int_t N;
+  Sexpr_t *elems;
+  buckets->any_svec_get_info(N, elems);
+  h = weak_hash(key, N);
+  for (Sexpr_t p = elems[h]; p != NIL; p = p->prechecked_anypair_get_cdr()) {
+    Sexpr_t e = p->prechecked_anypair_get_car();
+    if (e->prechecked_anypair_get_car() == key) return e;
+  }
+  return NIL;
+}
+
+Sexpr_t LambWeak::ephemeron_ref(Lamb &lamb, Sexpr_t table, Sexpr_t key, Sexpr_t dflt)
+{
+  Sexpr_t buckets;
+  Int_t h;
+  Sexpr_t e = weak_find(table, key, buckets, h);
+  return (e == NIL) ? dflt : e->prechecked_anypair_get_cdr();
+}
+
+void LambWeak::ephemeron_set(Lamb &lamb, Sexpr_t table, Sexpr_t key, Sexpr_t value, Sexpr_t env_exec)
+{
+  Sexpr_t buckets;
+  Int_t h;
+  Sexpr_t e = weak_find(table, key, buckets, h);
+  if (e != NIL) { lamb.set_cdr_bang(e, value);  return; }
+
+  LambRootScope roots(lamb);
+  roots.protect(key);
+  roots.protect(value);
+  e = roots.protect(lamb.cons(key, value, env_exec));
+  Int_t N;
+  Sexpr_t *elems;
+  buckets->any_svec_get_info(N, elems);
+  lamb.vector_set_bang(buckets, h, lamb.cons(e, elems[h], env_exec));
+}
+
+Bool_t LambWeak::ephemeron_delete(Lamb &lamb, Sexpr_t table, Sexpr_t key)
+{
+  Sexpr_t buckets;
+  Int_t h;
+  if (weak_find(table, key, buckets, h) == NIL) return false;
+  Int_t N;
+  Sexpr_t *elems;
+  buckets->any_svec_get_info(N, elems);
+  for (Sexpr_t p = elems[h], prev = NIL; p != NIL; prev = p, p = p->prechecked_anypair_get_cdr()) {
+    if (p->prechecked_anypair_get_car()->prechecked_anypair_get_car() != key) continue;
+    if (prev == NIL) lamb.vector_set_bang(buckets, h, p->prechecked_anypair_get_cdr());
+    else             lamb.set_cdr_bang(prev, p->prechecked_anypair_get_cdr());
+    break;
+  }
+  return true;
+}
+
+Int_t LambWeak::ephemeron_count(Lamb &lamb, Sexpr_t table)
+{
+  Sexpr_t buckets = weak_ref(weak_slot(table, weak_table)->index);
+  Int_t N, n = 0;
+  Sexpr_t *elems;
+  buckets->any_svec_get_info(N, elems);
+  for (Int_t h=0; h<N; h++) for (Sexpr_t p = elems[h]; p != NIL; p = p->prechecked_anypair_get_cdr()) n++;
+  return n;
+}
+
+Int_t LambWeak::sweep(Lamb &lamb)
+{
+  if (!weak_registry) return 0;
+  Word_t t0 = micros();
+  weak_reclaim(lamb);
+
+  LambHeapWalker walker(lamb);
+  walker.marks.test_and_set(weak_registry);	//not entered: its contents are reached only through the boxes and tables
+  walker.add_vm_roots();
+#if LL_GC_WRAP
+  MMRootStack *rs = mm_root_stack(lamb.mem);
+  for (Int_t i=0; i<rs->Nroots; i++) walker.add_root(rs->roots[i]);
+#endif
+  walker.walk();
+
+  //An ephemeron's value is reached once its key is, which can reach more keys, so repeat until nothing new is marked.
+  for (Bool_t more = true; more; ) {
+    more = false;
+    for (Int_t i=0; i<weak_Nslots; i++) {
+      WeakSlot &s = weak_slot_at(i);
+      if ((s.kind != weak_table) || s.dead || !walker.marks.test(s.holder)) continue;
+      Int_t N;
+      Sexpr_t *elems;
+      weak_ref(i)->any_svec_get_info(N, elems);
+      for (Int_t h=0; h<N; h++) {
+	for (Sexpr_t p = elems[h]; p != NIL; p = p->prechecked_anypair_get_cdr()) {
+	  Sexpr_t e = p->prechecked_anypair_get_car();
+	  Sexpr_t k = e->prechecked_anypair_get_car();
+	  if (!walker.marks.test(k) && !LambCellHandle::permanent(k)) continue;
+	  walker.add_root(e->prechecked_anypair_get_cdr());
+	  if (walker.walk()) more = true;
+	}
+      }
+    }
+  }
+
+  Int_t n = 0;
+  for (Int_t i=0; i<weak_Nslots; i++) {
+    WeakSlot &s = weak_slot_at(i);
+    if ((s.kind == weak_free) || s.dead || !walker.marks.test(s.holder)) continue;	//a holder not reached is garbage, reclaimed once swept
+    if (s.kind == weak_box) {
+      Sexpr_t t = weak_ref(i);
+      if (s.broken || walker.marks.test(t) || LambCellHandle::permanent(t)) continue;
+      lamb.vector_set_bang(weak_registry, i, HASHF);
+      s.broken = true;
+      n++;
+      continue;
+    }
+    Sexpr_t buckets = weak_ref(i);
+    Int_t N;
+    Sexpr_t *elems;
+    buckets->any_svec_get_info(N, elems);
+    for (Int_t h=0; h<N; h++) {
+      Sexpr_t prev = NIL;
+      for (Sexpr_t p = elems[h]; p != NIL; p = p->prechecked_anypair_get_cdr()) {
+	Sexpr_t k = p->prechecked_anypair_get_car()->prechecked_anypair_get_car();
+	if (walker.marks.test(k) || LambCellHandle::permanent(k)) { prev = p;  continue; }
+	if (prev == NIL) lamb.vector_set_bang(buckets, h, p->prechecked_anypair_get_cdr());
+	else             lamb.set_cdr_bang(prev, p->prechecked_anypair_get_cdr());
+	n++;
+      }
+    }
+  }
+
+  weak_sweeps++;
+  weak_broken    += n;
+  weak_last_us    = micros() - t0;
+  weak_last_ms    = millis();
+#if LL_GC_WRAP
+  weak_last_cycle = mm_field(lamb.mem, mm_offset_cycles);
+#endif
+  return n;
+}
+
+void LambWeak::idle(Lamb &lamb)
+{
+  if (!weak_used || ((Word_t) (millis() - weak_last_ms) < interval_ms)) return;
+#if LL_GC_WRAP
+  if (mm_field(lamb.mem, mm_offset_cycles) == weak_last_cycle) return;	//nothing collected since the last sweep
+#endif
+  sweep(lamb);
+}
+
+void LambWeak::stats(Int_t &used, Int_t &slots, Word_t &sweeps, Word_t &broken, Word_t &last_us)
+{
+  used    = weak_used;
+  slots   = weak_Nslots;
+  sweeps  = weak_sweeps;
+  broken  = weak_broken;
+  last_us = weak_last_us;
+}
+
+/*
+  Card marking for the vector barrier.
+  The epoch advances each time a marking cycle is seen to begin, and a table's card bytes are cleared when its epoch is out of date.
+*/
+LambCardTable::Table LambCardTable::tables[LambCardTable::Ntables];
+Int_t  LambCardTable::Nlive         = 0;
+Int_t  LambCardTable::next          = 0;
+Word_t LambCardTable::epoch         = 0;
+Int_t  LambCardTable::seen_cycles   = -1;
+Bool_t LambCardTable::marking       = false;
+Word_t LambCardTable::stores        = 0;
+Word_t LambCardTable::clean_stores  = 0;
+Word_t LambCardTable::cards_dirtied = 0;
+Word_t LambCardTable::shaded        = 0;
+
+//forget() runs wherever an array is deleted, on finalizer workers too, so the tables have a spinlock; the card bytes are realloc()ed, never new[], so that no delete[] calls back in under it.
+static char card_lock;
+static void card_take()	{ while (__atomic_test_and_set(&card_lock, __ATOMIC_ACQUIRE)) /*spin*/; }
+static void card_give()	{ __atomic_clear(&card_lock, __ATOMIC_RELEASE); }
+
+LambCardTable::Table *LambCardTable::lookup(Sexpr_t vec, Sexpr_t *elems, Int_t Nelems)
+{
+  card_take();
+  Table *t = 0;
+  for (Int_t i=0; i<Ntables; i++) if ((tables[i].vec == vec) && (tables[i].elems == elems) && (tables[i].Nelems == Nelems)) { t = &tables[i];  break; }
+  if (t) { card_give();  return t; }
+
+  //A new array, or one that has lost its table: take the next table round, with every card clean.
+  t = &tables[next];
+  next = (next + 1) % Ntables;
+  Int_t Ncards = ((Nelems - 1) >> card_shift) + 1;
+  if (t->Ncards < Ncards) {
+    uint8_t *cards = (uint8_t *) realloc(t->cards, Ncards);
+    if (!cards) {
+      //Without cards the table is not used: the store keeps the per-store barrier.
+      if (t->elems) Nlive--;
+      t->vec   = 0;
+      t->elems = 0;
+      card_give();
+      return 0;
+    }
+    t->cards  = cards;
+    t->Ncards = Ncards;
+  }
+  memset(t->cards, 0, t->Ncards);
+  if (!t->elems) Nlive++;
+  t->vec    = vec;
+  t->elems  = elems;
+  t->Nelems = Nelems;
+  t->epoch  = epoch;
+  card_give();
+  return t;
+}
+
+//The array is being deleted, and its address may be reused by another vector: its dirty cards must not carry over.
+void LambCardTable::forget(void *elems)
+{
+  if (!elems) return;
+  card_take();
+  for (Int_t i=0; i<Ntables; i++) {
+    if (tables[i].elems != elems) continue;
+    tables[i].vec   = 0;
+    tables[i].elems = 0;
+    Nlive--;
+  }
+  card_give();
+}
+
+#if LL_GC_WRAP
+/*
+  Lamb::vector_set_bang(), and the dictionaries in the VM library, store into vectors through LambMemoryManager::vector_set_bang().
+  Calls from inside the memory manager are not interposed, and keep the per-store barrier.
+*/
+void ll_vector_set_bang_real(LambMemoryManager *mm, Sexpr_t vec, Int_t k, Sexpr_t val) asm("__real__ZN17LambMemoryManager15vector_set_bangEP4CelliS1_");
+void ll_vector_set_bang_wrap(LambMemoryManager *mm, Sexpr_t vec, Int_t k, Sexpr_t val) asm("__wrap__ZN17LambMemoryManager15vector_set_bangEP4CelliS1_");
+
+void ll_vector_set_bang_wrap(LambMemoryManager *mm, Sexpr_t vec, Int_t k, Sexpr_t val)	{ LambAllocScope::stored(vec, val);  LambCardTable::vector_set(mm, vec, k, val); }
+
+void LambCardTable::vector_set(LambMemoryManager *mm, Sexpr_t vec, Int_t k, Sexpr_t val)
+{
+  if (mm_field(mm, mm_offset_state) != mm_marking) {
+    marking = false;
+    ll_vector_set_bang_real(mm, vec, k, val);
+    return;
+  }
+  Int_t N = 0;
+  Sexpr_t *elems;
+  if (vec->type() <= Cell::T_ANY_HEAP_SVEC) vec->any_svec_get_info(N, elems);
+  if ((N < min_elems) || (k < 0) || (k >= N)) {
+    ll_vector_set_bang_real(mm, vec, k, val);
+    return;
+  }
+
+  //A sweep ends each cycle, so a change in the cycle count also means a new marking cycle, even if no store was seen between the two.
+  Int_t cycles = mm_field(mm, mm_offset_cycles);
+  if (!marking || (cycles != seen_cycles)) {
+    epoch++;
+    seen_cycles = cycles;
+    marking     = true;
+  }
+
+  Table *t = lookup(vec, elems, N);
+  if (!t) {
+    ll_vector_set_bang_real(mm, vec, k, val);
+    return;
+  }
+  if (t->epoch != epoch) {
+    memset(t->cards, 0, t->Ncards);
+    t->epoch = epoch;
+  }
+  stores++;
+
+  uint8_t &card = t->cards[k >> card_shift];
+  if (card) clean_stores++;
+  else {
+    //Shade what the card holds now, through the library's own barrier, by storing each unmarked element over itself.
+    Int_t lo = k & ~((1 << card_shift) - 1);
+    Int_t hi = lo + (1 << card_shift);
+    if (hi > N) hi = N;
+    for (Int_t i=lo; i<hi; i++) {
+      if (elems[i]->gc_state() >= Cell::gcst_stacked) continue;
+      ll_vector_set_bang_real(mm, vec, i, elems[i]);
+      shaded++;
+    }
+    card = 1;
+    cards_dirtied++;
+  }
+  elems[k] = val;
+}
+#endif
+
+#if LL_GC_WRAP
+//The pair barriers, interposed for LambAllocScope.
+void ll_set_car_bang_real(LambMemoryManager *mm, Sexpr_t c, Sexpr_t val) asm("__real__ZN17LambMemoryManager12set_car_bangEP4CellS1_");
+void ll_set_car_bang_wrap(LambMemoryManager *mm, Sexpr_t c, Sexpr_t val) asm("__wrap__ZN17LambMemoryManager12set_car_bangEP4CellS1_");
+void ll_set_cdr_bang_real(LambMemoryManager *mm, Sexpr_t c, Sexpr_t val) asm("__real__ZN17LambMemoryManager12set_cdr_bangEP4CellS1_");
+void ll_set_cdr_bang_wrap(LambMemoryManager *mm, Sexpr_t c, Sexpr_t val) asm("__wrap__ZN17LambMemoryManager12set_cdr_bangEP4CellS1_");
+
+void ll_set_car_bang_wrap(LambMemoryManager *mm, Sexpr_t c, Sexpr_t val)	{ LambAllocScope::stored(c, val);  ll_set_car_bang_real(mm, c, val); }
+void ll_set_cdr_bang_wrap(LambMemoryManager *mm, Sexpr_t c, Sexpr_t val)	{ LambAllocScope::stored(c, val);  ll_set_cdr_bang_real(mm, c, val); }
+#endif
+
+/*
+  External memory.
+  Counted objects and payloads are kept in an open-addressed table keyed by address, with their bytes and, for objects, their own deleter.
+  Payloads are deleted wherever the library or a finalizer deletes arrays, so the table has its own spinlock and is allocated with calloc(), never new[].
+  The bytes count down on whichever thread frees them, and up on the VM thread.
+*/
+struct ExtEntry { void *key;  CPPDeleterPtr deleter;  Word_t bytes; };
+static ExtEntry *ext_table;
+static Int_t ext_Nslots;
+static char ext_lock;
+static LambMemoryManager *ext_mm;
+static Word_t ext_base;			//bytes live through the last cycle
+#if LL_GC_WRAP
+static Word_t ext_debt;			//bytes charged since the end of the last cycle
+static Word_t ext_driven;		//quanta run for the debt since then
+static Int_t ext_cycles = -1;
+#endif
+
+Word_t LambExternal::min_bytes  = 1 << 20;
+Int_t  LambExternal::growth_pct = 100;
+Word_t LambExternal::live;
+Word_t LambExternal::live_max;
+Word_t LambExternal::charged;
+Word_t LambExternal::triggers;
+Word_t LambExternal::quanta;
+Int_t  LambExternal::Ntracked;
+
+static void ext_take()	{ while (__atomic_test_and_set(&ext_lock, __ATOMIC_ACQUIRE)) /*spin*/; }
+static void ext_give()	{ __atomic_clear(&ext_lock, __ATOMIC_RELEASE); }
+static Int_t ext_hash(void *p)	{ return (Int_t) (((((Word_t) p) >> 4) * 2654435761u) & (ext_Nslots - 1)); }
+
+//The slot holding p, or the empty slot ending its probe run.
+static Int_t ext_find(void *p)
+{
+  Int_t i = ext_hash(p);
+  while (ext_table[i].key && (ext_table[i].key != p)) i = (i + 1) & (ext_Nslots - 1);
+  return i;
+}
+
+static Bool_t ext_grow()
+{
+  ExtEntry *old = ext_table;
+  Int_t Nold = ext_Nslots;
+  Int_t N = Nold ? 2 * Nold : 64;
+  ExtEntry *t = (ExtEntry *) calloc(N, sizeof(ExtEntry));
+  if (!t) return false;
+  ext_table  = t;
+  ext_Nslots = N;
+  for (Int_t i=0; i<Nold; i++) if (old[i].key) ext_table[ext_find(old[i].key)] = old[i];
+  free(old);
+  return true;
+}
+
+//Empty slot i, moving later entries of its probe run back so that no lookup stops short of them.
+static void ext_remove(Int_t i)
+{
+  Int_t mask = ext_Nslots - 1;
+  for (Int_t j = (i + 1) & mask; ext_table[j].key; j = (j + 1) & mask) {
+    Int_t h = ext_hash(ext_table[j].key);
+    if (((j - h) & mask) >= ((j - i) & mask)) { ext_table[i] = ext_table[j];  i = j; }
+  }
+  ext_table[i].key = 0;
+}
+
+void LambExternal::bind(Lamb &lamb)	{ ext_mm = lamb.mem; }
+
+Word_t LambExternal::budget()
+{
+  Word_t b = ext_base / 100 * growth_pct;
+  return (b > min_bytes) ? b : min_bytes;
+}
+
+#if LL_GC_WRAP
+/*
+  A cycle is paced by cell allocation, so with few cells made it can run on while much more external memory is charged.
+  Run GC quanta here as well, enough for a whole cycle per budget of debt, but stop at its end: a new cycle starts only in the library's own quantum.
+*/
+
+static void ext_drive(Sexpr_t env_exec)
+{
+  Int_t Q = mm_field(ext_mm, mm_offset_Qs);
+  Word_t Nquanta = (Word_t) mm_field(ext_mm, mm_offset_Nblocks) * LambCellArena::cells_per_block / ((Q > 0) ? Q : 1);
+  Word_t owed = ext_debt / (LambExternal::budget() / (Nquanta + 1) + 1);
+  if (owed > Nquanta) owed = Nquanta;
+
+  Int_t st;
+  Word_t n = 0;
+  while ((ext_driven < owed) && (((st = mm_field(ext_mm, mm_offset_state)) == mm_marking) || (st == mm_sweeping))) {
+    ll_mm_gc_pass(ext_mm, env_exec);
+    ext_driven++;
+    n++;
+  }
+  if (!n) return;
+  LambExternal::quanta += n;
+  lambGCTelemetry.observe();
+}
+#endif
+
+void LambExternal::charge(Word_t bytes, Sexpr_t env_exec)
+{
+  Word_t n = __atomic_add_fetch(&live, bytes, __ATOMIC_RELAXED);
+  Word_t m = __atomic_load_n(&live_max, __ATOMIC_RELAXED);
+  while ((n > m) && !__atomic_compare_exchange_n(&live_max, &m, n, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) /*retry*/;
+  __atomic_add_fetch(&charged, bytes, __ATOMIC_RELAXED);
+#if LL_GC_WRAP
+  if (!ext_mm) return;
+  Int_t cycles = mm_field(ext_mm, mm_offset_cycles);
+  if (cycles != ext_cycles) {
+    //What was charged during the cycle was not collectable in it; the base is what survived from before.
+    Word_t before = n - bytes;
+    ext_base   = (before > ext_debt) ? before - ext_debt : 0;
+    ext_cycles = cycles;
+    ext_debt   = 0;
+    ext_driven = 0;
+  }
+  ext_debt += bytes;
+
+  Int_t st = mm_field(ext_mm, mm_offset_state);
+  if ((st == mm_marking) || (st == mm_sweeping)) { ext_drive(env_exec);  return; }
+  if ((st != mm_idle) || (ext_debt < budget())) return;
+
+  //The library's GC quantum starts a cycle from idle when its own trigger allows; until then the debt stands, and the next charge offers another.
+  ll_mm_gc_pass(ext_mm, env_exec);
+  quanta++;
+  if (mm_field(ext_mm, mm_offset_state) == mm_idle) return;
+  triggers++;
+  ext_driven++;
+  lambGCTelemetry.observe();
+#endif
+}
+
+void LambExternal::credit(Word_t bytes)	{ __atomic_sub_fetch(&live, bytes, __ATOMIC_RELAXED); }
+
+Bool_t LambExternal::track(void *obj, CPPDeleterPtr deleter, Word_t bytes, Sexpr_t env_exec)
+{
+  Word_t old = 0;
+  ext_take();
+  if ((2 * (Ntracked + 1) > ext_Nslots) && !ext_grow()) { ext_give();  return false; }
+  Int_t i = ext_find(obj);
+  if (ext_table[i].key) old = ext_table[i].bytes;
+  else Ntracked++;
+  ext_table[i].key     = obj;
+  ext_table[i].deleter = deleter;
+  ext_table[i].bytes   = bytes;
+  ext_give();
+  credit(old);
+  charge(bytes, env_exec);
+  return true;
+}
+
+void LambExternal::release(void *obj)
+{
+  CPPDeleterPtr d = 0;
+  Word_t bytes = 0;
+  ext_take();
+  if (Ntracked) {
+    Int_t i = ext_find(obj);
+    if (ext_table[i].key) { d = ext_table[i].deleter;  bytes = ext_table[i].bytes;  ext_remove(i);  Ntracked--; }
+  }
+  ext_give();
+  credit(bytes);
+  if (d) d(obj);
+}
+
+//Only payloads: an object is credited by its cell's deleter, however its own deleter frees it.
+void LambExternal::untrack(void *p)
+{
+  Word_t bytes = 0;
+  ext_take();
+  if (Ntracked) {
+    Int_t i = ext_find(p);
+    if (ext_table[i].key && !ext_table[i].deleter) { bytes = ext_table[i].bytes;  ext_remove(i);  Ntracked--; }
+  }
+  ext_give();
+  credit(bytes);
+}
+
+//Charged before the cell is made: a cycle started by the charge would not mark a cell held only here.
+Sexpr_t Lamb::mk_cppobj(void *obj, CPPDeleterPtr deleter, Word_t ext_bytes, Sexpr_t env_exec)
+{
+  LambExternal::bind(*this);
+  if (!LambExternal::track(obj, deleter, ext_bytes, env_exec)) return tcons(Cell::T_CPP_HEAP, (Word_t) deleter, (Word_t) obj, env_exec);	//uncounted
+  return tcons(Cell::T_CPP_HEAP, (Word_t) LambExternal::release, (Word_t) obj, env_exec);
+}
+
+Sexpr_t Lamb::mk_bytevector_counted(Int_t k, Int_t fill, Sexpr_t env_exec)
+{
+  Sexpr_t bv = mk_bytevector(k, env_exec);
+  memset(bv->any_bvec_get_elems(), fill, k);
+#if LL_HEAP_WRAP
+  if (bv->type() == Cell::T_BVEC_HEAP) {
+    LambRootScope roots(*this);
+    roots.protect(bv);
+    LambExternal::bind(*this);
+    LambExternal::track(bv->any_bvec_get_elems(), 0, k, env_exec);
+  }
+#endif
+  return bv;
+}
+
+/*
+  Allocation scopes.
+  The bitmap is allocated on first use, not at static construction, because operator new[] is interposed on LL_HEAP_WRAP builds.
+*/
+LambAllocScope *LambAllocScope::current;
+Bool_t LambAllocScope::per_loop;
+Word_t LambAllocScope::scopes;
+Word_t LambAllocScope::total_cells;
+Word_t LambAllocScope::total_escaped;
+Word_t LambAllocScope::max_cells;
+Word_t LambAllocScope::last_cells;
+Word_t LambAllocScope::last_escaped;
+LambMarkBitmap *LambAllocScope::young;
+Word_t LambAllocScope::allocs;
+Word_t LambAllocScope::escapes;
+
+static Sexpr_t *escape_stack;
+static Int_t escape_cap;
+
+LambAllocScope::LambAllocScope(Bool_t open) : open(open)
+{
+  outer = current;
+  if (!open) return;
+  if (!young) young = new LambMarkBitmap;
+  allocs0  = allocs;
+  escapes0 = escapes;
+  current  = this;
+}
+
+LambAllocScope::~LambAllocScope()
+{
+  if (!open) return;
+  current = outer;
+  last_cells   = cells();
+  last_escaped = escaped();
+  scopes++;
+  total_cells   += last_cells;
+  total_escaped += last_escaped;
+  if (last_cells > max_cells) max_cells = last_cells;
+  if (!current) young->clear();		//what is left is garbage, or held where no barrier sees it
+}
+
+Word_t LambAllocScope::cells()		{ return allocs - allocs0; }
+Word_t LambAllocScope::escaped()	{ return escapes - escapes0; }
+
+//Unmark *c* and the new cells reachable from it, counting each.
+void LambAllocScope::escape(Sexpr_t c)
+{
+  Int_t sp = 0;
+  young->test_and_clear(c);
+  escape_stack = escape_stack ? escape_stack : new Sexpr_t[escape_cap = 256];
+  escape_stack[sp++] = c;
+  while (sp) {
+    c = escape_stack[--sp];
+    escapes++;
+
+    Int_t typ = c->type();
+    Int_t Nkids = 0;
+    Sexpr_t pair[2];
+    Sexpr_t *kids = pair;
+    if (typ >= Cell::T_PAIR) { pair[0] = c->prechecked_anypair_get_car();  pair[1] = c->prechecked_anypair_get_cdr();  Nkids = 2; }
+    else if (typ <= Cell::T_ANY_HEAP_SVEC) c->any_svec_get_info(Nkids, kids);
+
+    for (Int_t i=0; i<Nkids; i++) {
+      if (!young->test_and_clear(kids[i])) continue;
+      if (sp == escape_cap) {
+	Sexpr_t *ns = new Sexpr_t[2 * escape_cap];
+	memcpy(ns, escape_stack, sp * sizeof(Sexpr_t));
+	delete[] escape_stack;
+	escape_stack = ns;
+	escape_cap  *= 2;
+      }
+      escape_stack[sp++] = kids[i];
+    }
+  }
+}
+
+//Cons a (key . value) pair onto the alist; counters that outgrow Int_t are reported as reals.
+static Sexpr_t alist_add(Lamb &lamb, Sexpr_t alist, const char *key, uint64_t n, Sexpr_t env_exec)
+{
+  LambRootScope roots(lamb);
+  roots.protect(alist);
+  Sexpr_t val = roots.protect((n <= 0x7fffffff) ? lamb.mk_integer((Int_t) n, env_exec) : lamb.mk_real((Real_t) n, env_exec));
+  Sexpr_t kv  = lamb.cons(lamb.mk_symbol(key, env_exec), val, env_exec);
+  return lamb.cons(kv, alist, env_exec);
+}
+
+//(GC.pacing ['idle | 'demand | 'deadline]) => the pacing mode in effect.
+Sexpr_t GC_mop3_pacing(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  ME("::GC_mop3_pacing()");
+  if (sexpr != NIL) {
+    Sexpr_t mode = lamb.car(sexpr);
+    Int_t p = 0;
+    while ((p < LambGCPacer::Npacings) && (mode != lamb.mk_symbol(LambGCPacer::pacing_name(p), env_exec))) p++;
+    if (p == LambGCPacer::Npacings) throw lamb.mk_error(env_exec, "%s Unknown pacing %s", me, mode->str().c_str());
+    if (isdef(LL_GC_WRAP)) lambGCPacer.pacing = p;
+  }
+  return lamb.mk_symbol(LambGCPacer::pacing_name(lambGCPacer.pacing), env_exec);
+}
+
+//(GC.pacing-stats) => alist of idle-time GC and loop timing counters.
+Sexpr_t GC_mop3_pacing_stats(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  Sexpr_t res = NIL;
+  res = alist_add(lamb, res, "loop-us-max", lambPlatform.loop_us_max(), env_exec);
+  res = alist_add(lamb, res, "loop-us", lambPlatform.loop_us_total(), env_exec);
+  res = alist_add(lamb, res, "loops", lambPlatform.loop_count(), env_exec);
+  res = alist_add(lamb, res, "deadline-overruns", lambGCPacer.deadline_overruns, env_exec);
+  res = alist_add(lamb, res, "deadline-skips", lambGCPacer.deadline_skips, env_exec);
+  res = alist_add(lamb, res, "idle-us-max", lambGCPacer.idle_us_max, env_exec);
+  res = alist_add(lamb, res, "idle-us", lambGCPacer.idle_us, env_exec);
+  res = alist_add(lamb, res, "idle-runs", lambGCPacer.idle_runs, env_exec);
+  res = alist_add(lamb, res, "idle-calls", lambGCPacer.idle_calls, env_exec);
+  return res;
+}
+
+Sexpr_t GC_mop3_pacing_stats_reset(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)	{ lambGCPacer.reset();  lambPlatform.loop_stats_reset();  return OBJ_UNDEF; }
+
+/*
+  (GC.deadline [period-us budget-us [jitter-us]]) => (period-us budget-us jitter-us gain), gain in 1/256ths.
+  With arguments, set the deadline controller and switch to deadline pacing; the jitter bound defaults to 10% of the period.
+*/
+Sexpr_t GC_mop3_deadline(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  ME("::GC_mop3_deadline()");
+  if (sexpr != NIL) {
+    Int_t period = lamb.car(sexpr)->mustbe_Int_t();
+    Int_t budget = lamb.cadr(sexpr)->mustbe_Int_t();
+    Int_t jitter = (lamb.cddr(sexpr) != NIL) ? lamb.caddr(sexpr)->mustbe_Int_t() : period / 10;
+    if ((period <= 0) || (budget <= 0) || (jitter < 0)) throw lamb.mk_error(env_exec, "%s Bad deadline %d %d %d", me, period, budget, jitter);
+    lambGCPacer.period_us = period;
+    lambGCPacer.budget_us = budget;
+    lambGCPacer.jitter_us = jitter;
+    lambGCPacer.gain      = LambGCPacer::gain_one;
+    if (isdef(LL_GC_WRAP)) lambGCPacer.pacing = LambGCPacer::pace_deadline;
+  }
+
+  const Int_t v[] = { lambGCPacer.period_us, lambGCPacer.budget_us, lambGCPacer.jitter_us, lambGCPacer.gain };
+  LambRootScope roots(lamb);
+  Sexpr_t res = roots.protect(NIL);
+  for (Int_t i=3; i>=0; i--) {
+    Sexpr_t n = roots.protect(lamb.mk_integer(v[i], env_exec));
+    res = roots.protect(lamb.cons(n, res, env_exec));
+  }
+  return res;
+}
+
+//(GC.finalizer-stats) => alist of the deferred deleter counters; workers is the number of threads running the queue.
+Sexpr_t GC_mop3_finalizer_stats(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  Word_t queued, run, inline_run;
+  Int_t depth, depth_max;
+  LambFinalizer::stats(queued, run, inline_run, depth, depth_max);
+
+  Sexpr_t res = NIL;
+  res = alist_add(lamb, res, "workers", LambFinalizer::workers(), env_exec);
+  res = alist_add(lamb, res, "depth-max", depth_max, env_exec);
+  res = alist_add(lamb, res, "depth", depth, env_exec);
+  res = alist_add(lamb, res, "inline", inline_run, env_exec);
+  res = alist_add(lamb, res, "run", run, env_exec);
+  res = alist_add(lamb, res, "queued", queued, env_exec);
+  return res;
+}
+
+//(GC.finalizer-threads [n]) => the number of finalizer worker threads, after setting it to n if given.
+Sexpr_t GC_mop3_finalizer_threads(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  if (sexpr != NIL) LambFinalizer::set_workers(lamb.car(sexpr)->mustbe_Int_t());
+  return lamb.mk_integer(LambFinalizer::workers(), env_exec);
+}
+
+static Int_t fin_bench_us, fin_bench_done;
+
+static void fin_bench_work(void *)
+{
+  unsigned long t0 = micros();
+  while ((Int_t) (micros() - t0) < fin_bench_us) /*busy*/;
+  FIN_LOCK();
+  fin_bench_done++;
+  FIN_UNLOCK();
+}
+
+//Wait for the pool, or run the queue here when there is none; return the number of deleters finished and the queue depth.
+static Int_t fin_bench_wait(Int_t &depth)
+{
+  if (!LambFinalizer::worker_running()) LambFinalizer::drain();
+#if LL_POSIX
+  sched_yield();
+#endif
+  FIN_LOCK();
+  Int_t done = fin_bench_done;
+  depth = fin_depth;
+  FIN_UNLOCK();
+  return done;
+}
+
+/*
+  (GC.finalizer-bench [deleters work-us max-threads]) => ((threads . us) ...), the time to run the deleters through the queue with 1 to max-threads workers.
+  Each deleter is busy for work-us.  The defaults are 2000 deleters of 50us, and 4 threads; the pool size is restored afterwards.
+*/
+Sexpr_t GC_mop3_finalizer_bench(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  Int_t Ndeleters = 2000, max_threads = 4;
+  fin_bench_us = 50;
+  if (sexpr != NIL) {
+    Ndeleters = lamb.car(sexpr)->mustbe_Int_t();
+    if (lamb.cdr(sexpr) != NIL) fin_bench_us = lamb.cadr(sexpr)->mustbe_Int_t();
+    if (lamb.cddr(sexpr) != NIL) max_threads = lamb.caddr(sexpr)->mustbe_Int_t();
+  }
+  if (max_threads > LambFinalizer::Nworkers_max) max_threads = LambFinalizer::Nworkers_max;
+
+  Int_t prev = LambFinalizer::workers();
+  Int_t us[LambFinalizer::Nworkers_max + 1];
+  for (Int_t t=1; t<=max_threads; t++) {
+    LambFinalizer::set_workers(t);
+    Int_t depth;
+    Int_t target = fin_bench_wait(depth) + Ndeleters;
+    unsigned long t0 = micros();
+    for (Int_t i=0; i<Ndeleters; i++) {
+      while (depth == LambFinalizer::Nqueue) fin_bench_wait(depth);
+      LambFinalizer::defer(fin_bench_work, 0);
+      depth++;
+    }
+    while (fin_bench_wait(depth) < target) /*wait*/;
+    us[t] = micros() - t0;
+  }
+  LambFinalizer::set_workers(prev);
+
+  Sexpr_t res = NIL;
+  for (Int_t t=max_threads; t>=1; t--) {
+    LambRootScope roots(lamb);
+    roots.protect(res);
+    Sexpr_t kv = roots.protect(lamb.cons(lamb.mk_integer(t, env_exec), lamb.mk_integer(us[t], env_exec), env_exec));
+    res = lamb.cons(kv, res, env_exec);
+  }
+  return res;
+}
+
+//Cells marked per microsecond walking from *root*; one pass first lays out the walker's bitmap.
+static Real_t mark_bench_rate(Lamb &lamb, Sexpr_t root, Int_t Npasses)
+{
+  LambHeapWalker walker(lamb);
+  walker.add_root(root);
+  walker.walk();
+
+  Word_t Ncells = 0;
+  Int_t t0 = micros();
+  for (Int_t pass=0; pass<Npasses; pass++) {
+    walker.marks.clear();
+    walker.add_root(root);
+    Ncells += walker.walk();
+  }
+  Int_t us = micros() - t0;
+  return (Real_t) Ncells / ((us > 0) ? us : 1);
+}
+
+/*
+  (GC.mark-bench [cells passes]) => alist of LambHeapWalker mark throughput, in cells per microsecond.
+  The heap is built here: *cells* pairs, linked in shuffled address order first into a list and then into a binary tree, so that most steps miss the cache.
+  Each shape is walked *passes* times.
+  The defaults are 50000 cells and 10 passes.
+*/
+Sexpr_t GC_mop3_mark_bench(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  Int_t Ncells = 50000, Npasses = 10;
+  if (sexpr != NIL) {
+    Ncells = lamb.car(sexpr)->mustbe_Int_t();
+    if (lamb.cdr(sexpr) != NIL) Npasses = lamb.cadr(sexpr)->mustbe_Int_t();
+  }
+  if (Ncells < 1) Ncells = 1;
+  if (Npasses < 1) Npasses = 1;
+
+  LambRootScope roots(lamb);
+  Sexpr_t v = roots.protect(lamb.mk_vector(Ncells, NIL, env_exec));
+  for (Int_t i=0; i<Ncells; i++) lamb.vector_set_bang(v, i, lamb.cons(NIL, NIL, env_exec));
+  Int_t N;
+  Sexpr_t *cells;
+  v->any_svec_get_info(N, cells);
+
+  //No cell is made from here to the results, so the element array stays put.
+  Int_t *perm = new Int_t[Ncells];
+  uint32_t x = 2463534242u;
+  for (Int_t i=0; i<Ncells; i++) perm[i] = i;
+  for (Int_t i=Ncells-1; i>0; i--) {
+    x ^= x << 13;  x ^= x >> 17;  x ^= x << 5;
+    Int_t j = x % (i + 1);
+    Int_t t = perm[i];  perm[i] = perm[j];  perm[j] = t;
+  }
+  Sexpr_t root = cells[perm[0]];
+
+  for (Int_t i=0; i<Ncells; i++) lamb.set_cdr_bang(cells[perm[i]], (i + 1 < Ncells) ? cells[perm[i + 1]] : NIL);
+  Real_t list_rate = mark_bench_rate(lamb, root, Npasses);
+
+  for (Int_t i=0; i<Ncells; i++) {
+    lamb.set_car_bang(cells[perm[i]], (2 * i + 1 < Ncells) ? cells[perm[2 * i + 1]] : NIL);
+    lamb.set_cdr_bang(cells[perm[i]], (2 * i + 2 < Ncells) ? cells[perm[2 * i + 2]] : NIL);
+  }
+  Real_t tree_rate = mark_bench_rate(lamb, root, Npasses);
+  delete[] perm;
+
+  const struct { const char *key;  Real_t rate; } rates[] = { { "tree-cells-per-us", tree_rate }, { "list-cells-per-us", list_rate } };
+  Sexpr_t res = roots.protect(NIL);
+  for (auto &r : rates) {
+    Sexpr_t rate = roots.protect(lamb.mk_real(r.rate, env_exec));
+    Sexpr_t kv   = roots.protect(lamb.cons(lamb.mk_symbol(r.key, env_exec), rate, env_exec));
+    res = roots.protect(lamb.cons(kv, res, env_exec));
+  }
+  res = alist_add(lamb, res, "passes", Npasses, env_exec);
+  res = alist_add(lamb, res, "cells", Ncells, env_exec);
+  return res;
+}
+
+#if LL_GC_WRAP
+/*
+  (GC.heap-policy [initial-blocks max-blocks growth-pct lock]) => the heap sizing in effect, as an alist.
+  With arguments, the policy is changed first and the heap pre-expanded to the new initial size.
+*/
+Sexpr_t GC_mop3_heap_policy(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  if (sexpr != NIL) {
+    Int_t v[3] = { LambHeapPolicy::initial_blocks, LambHeapPolicy::max_blocks, LambHeapPolicy::growth_pct };
+    Bool_t l   = LambHeapPolicy::lock;
+    for (Int_t i=0; (i < 3) && (sexpr != NIL); i++, sexpr = lamb.cdr(sexpr)) v[i] = lamb.car(sexpr)->mustbe_Int_t();
+    if (sexpr != NIL) l = lamb.car(sexpr) != HASHF;
+    LambHeapPolicy::configure(v[0], v[1], v[2], l);
+    LambHeapPolicy::apply(lamb);
+  }
+
+  Sexpr_t res = NIL;
+  res = alist_add(lamb, res, "policy-expands", LambHeapPolicy::policy_expands, env_exec);
+  res = alist_add(lamb, res, "vm-expands", LambHeapPolicy::vm_expands, env_exec);
+  res = alist_add(lamb, res, "locked", LambHeapPolicy::locked ? 1 : 0, env_exec);
+  res = alist_add(lamb, res, "growth-pct", LambHeapPolicy::growth_pct, env_exec);
+  res = alist_add(lamb, res, "max-blocks", LambHeapPolicy::max_blocks, env_exec);
+  res = alist_add(lamb, res, "initial-blocks", LambHeapPolicy::initial_blocks, env_exec);
+  res = alist_add(lamb, res, "cells", LambHeapPolicy::blocks() * LambCellArena::cells_per_block, env_exec);
+  res = alist_add(lamb, res, "blocks", LambHeapPolicy::blocks(), env_exec);
+  return res;
+}
+#endif
+
+//(GC.make-weak-box obj) => a weak box referring to obj without keeping it alive.
+Sexpr_t GC_mop3_make_weak_box(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)	{ return LambWeak::mk_weak_box(lamb, lamb.car(sexpr), env_exec); }
+Sexpr_t GC_mop3_weak_box_p(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)		{ return lamb.mk_bool(LambWeak::is_weak_box(lamb.car(sexpr)), env_exec); }
+
+//(GC.weak-box-value box [default]) => the object in the box, or default (#f) once it has been collected.
+Sexpr_t GC_mop3_weak_box_value(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  ME("::GC_mop3_weak_box_value()");
+  Sexpr_t box = lamb.car(sexpr);
+  if (!LambWeak::is_weak_box(box)) throw lamb.mk_error(env_exec, "%s Not a weak box", me);
+  return LambWeak::weak_box_ref(box, (lamb.cdr(sexpr) == NIL) ? HASHF : lamb.cadr(sexpr));
+}
+
+//(GC.make-ephemeron-table [size]) => an eq? table whose entries live only as long as their keys; size is the number of buckets (default 64).
+Sexpr_t GC_mop3_make_ephemeron_table(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  return LambWeak::mk_ephemeron_table(lamb, (sexpr == NIL) ? 64 : lamb.car(sexpr)->mustbe_Int_t(), env_exec);
+}
+
+Sexpr_t GC_mop3_ephemeron_table_p(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)	{ return lamb.mk_bool(LambWeak::is_ephemeron_table(lamb.car(sexpr)), env_exec); }
+
+static Sexpr_t mustbe_ephemeron_table(Lamb &lamb, Sexpr_t c, Charst_t me, Sexpr_t env_exec)
+{
+  if (!LambWeak::is_ephemeron_table(c)) throw lamb.mk_error(env_exec, "%s Not an ephemeron table", me);
+  return c;
+}
+
+//(GC.ephemeron-ref table key [default]) => the value for key, or default (#f).
+Sexpr_t GC_mop3_ephemeron_ref(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  ME("::GC_mop3_ephemeron_ref()");
+  Sexpr_t table = mustbe_ephemeron_table(lamb, lamb.car(sexpr), me, env_exec);
+  Sexpr_t rest  = lamb.cdr(sexpr);
+  return LambWeak::ephemeron_ref(lamb, table, lamb.car(rest), (lamb.cdr(rest) == NIL) ? HASHF : lamb.cadr(rest));
+}
+
+//(GC.ephemeron-set! table key value)
+Sexpr_t GC_mop3_ephemeron_set(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  ME("::GC_mop3_ephemeron_set()");
+  Sexpr_t table = mustbe_ephemeron_table(lamb, lamb.car(sexpr), me, env_exec);
+  LambWeak::ephemeron_set(lamb, table, lamb.cadr(sexpr), lamb.car(lamb.cddr(sexpr)), env_exec);
+  return OBJ_UNDEF;
+}
+
+//(GC.ephemeron-delete! table key) => #t if the key was in the table.
+Sexpr_t GC_mop3_ephemeron_delete(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  ME("::GC_mop3_ephemeron_delete()");
+  Sexpr_t table = mustbe_ephemeron_table(lamb, lamb.car(sexpr), me, env_exec);
+  return lamb.mk_bool(LambWeak::ephemeron_delete(lamb, table, lamb.cadr(sexpr)), env_exec);
+}
+
+//(GC.ephemeron-count table) => number of entries.
+Sexpr_t GC_mop3_ephemeron_count(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  ME("::GC_mop3_ephemeron_count()");
+  Sexpr_t table = mustbe_ephemeron_table(lamb, lamb.car(sexpr), me, env_exec);
+  return lamb.mk_integer(LambWeak::ephemeron_count(lamb, table), env_exec);
+}
+
+//(GC.weak-stats [interval-ms]) => weak reference counters; sets the least time between sweeps from ::loop() if given.
+Sexpr_t GC_mop3_weak_stats(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  if (sexpr != NIL) LambWeak::interval_ms = lamb.car(sexpr)->mustbe_Int_t();
+  Int_t used, slots;
+  Word_t sweeps, broken, last_us;
+  LambWeak::stats(used, slots, sweeps, broken, last_us);
+
+  Sexpr_t res = NIL;
+  res = alist_add(lamb, res, "interval-ms", LambWeak::interval_ms, env_exec);
+  res = alist_add(lamb, res, "last-us", last_us, env_exec);
+  res = alist_add(lamb, res, "broken", broken, env_exec);
+  res = alist_add(lamb, res, "sweeps", sweeps, env_exec);
+  res = alist_add(lamb, res, "slots", slots, env_exec);
+  res = alist_add(lamb, res, "used", used, env_exec);
+  return res;
+}
+
+//(GC.external-bytes) => native memory held behind cells, as counted by LambExternal.
+Sexpr_t GC_mop3_external_bytes(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  Word_t n = LambExternal::live;
+  return (n <= 0x7fffffff) ? lamb.mk_integer((Int_t) n, env_exec) : lamb.mk_real((Real_t) n, env_exec);
+}
+
+//(GC.external-stats [min-bytes growth-pct]) => alist of the external memory counters; sets the debt budget if given.
+Sexpr_t GC_mop3_external_stats(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  if (sexpr != NIL) {
+    LambExternal::min_bytes = lamb.car(sexpr)->mustbe_Int_t();
+    if (lamb.cdr(sexpr) != NIL) LambExternal::growth_pct = lamb.car(lamb.cdr(sexpr))->mustbe_Int_t();
+  }
+  Sexpr_t res = NIL;
+  res = alist_add(lamb, res, "quanta", LambExternal::quanta, env_exec);
+  res = alist_add(lamb, res, "triggers", LambExternal::triggers, env_exec);
+  res = alist_add(lamb, res, "charged", LambExternal::charged, env_exec);
+  res = alist_add(lamb, res, "budget", LambExternal::budget(), env_exec);
+  res = alist_add(lamb, res, "growth-pct", LambExternal::growth_pct, env_exec);
+  res = alist_add(lamb, res, "min-bytes", LambExternal::min_bytes, env_exec);
+  res = alist_add(lamb, res, "live-max", LambExternal::live_max, env_exec);
+  res = alist_add(lamb, res, "live", LambExternal::live, env_exec);
+  return res;
+}
+
+//(GC.make-counted-bytevector k [fill]) => a bytevector whose payload counts as external memory (LL_HEAP_WRAP builds).
+Sexpr_t GC_mop3_make_counted_bytevector(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  Int_t k    = lamb.car(sexpr)->mustbe_Int_t();
+  Int_t fill = (lamb.cdr(sexpr) != NIL) ? lamb.car(lamb.cdr(sexpr))->mustbe_Int_t() : 0;
+  return lamb.mk_bytevector_counted(k, fill, env_exec);
+}
+
+/*
+  (GC.census) => the cells in use by type and the free and issued cells by block, as an alist:
+  - types: a (type cells payload-bytes) list for each type in use;
+  - blocks: a (free issued runs longest fragmentation-pct) list for each block, in block order;
+  - totals: in-use, free, issued cells, and the microseconds the count took.
+*/
+Sexpr_t GC_mop3_census(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  static LambHeapCensus census;
+  census.take(lamb);
+
+  LambRootScope roots(lamb);
+  Sexpr_t types = roots.protect(NIL);
+  for (Int_t t=Cell::Ntypes-1; t>=0; t--) {
+    if (!census.cells[t]) continue;
+    Word_t n = census.bytes[t];
+    Sexpr_t row = roots.protect((n <= 0x7fffffff) ? lamb.mk_integer((Int_t) n, env_exec) : lamb.mk_real((Real_t) n, env_exec));
+    row = roots.protect(lamb.cons(row, NIL, env_exec));
+    Sexpr_t cells = roots.protect(lamb.mk_integer((Int_t) census.cells[t], env_exec));
+    row = roots.protect(lamb.cons(cells, row, env_exec));
+    row = roots.protect(lamb.cons(lamb.mk_symbol(cell_type_name(t), env_exec), row, env_exec));
+    types = roots.protect(lamb.cons(row, types, env_exec));
+  }
+
+  Sexpr_t blocks = roots.protect(NIL);
+  for (Int_t b=census.Nblocks-1; b>=0; b--) {
+    LambHeapCensus::Block &blk = census.block[b];
+    const Int_t v[] = { blk.free, blk.issued, blk.runs, blk.longest, blk.frag_pct() };
+    Sexpr_t row = roots.protect(NIL);
+    for (Int_t i=(Int_t) (sizeof(v)/sizeof(v[0]))-1; i>=0; i--) {
+      Sexpr_t n = roots.protect(lamb.mk_integer(v[i], env_exec));
+      row = roots.protect(lamb.cons(n, row, env_exec));
+    }
+    blocks = roots.protect(lamb.cons(row, blocks, env_exec));
+  }
+
+  Word_t in_use = 0;
+  for (Int_t t=0; t<Cell::Ntypes; t++) in_use += census.cells[t];
+
+  Sexpr_t res = NIL;
+  res = alist_add(lamb, res, "us", census.us, env_exec);
+  res = alist_add(lamb, res, "issued", census.Nissued, env_exec);
+  res = alist_add(lamb, res, "free", census.Nfree, env_exec);
+  res = alist_add(lamb, res, "in-use", in_use, env_exec);
+  roots.protect(res);
+  Sexpr_t kv = roots.protect(lamb.cons(lamb.mk_symbol("blocks", env_exec), blocks, env_exec));
+  res = roots.protect(lamb.cons(kv, res, env_exec));
+  kv  = roots.protect(lamb.cons(lamb.mk_symbol("types", env_exec), types, env_exec));
+  res = lamb.cons(kv, res, env_exec);
+  return res;
+}
+
+#if LL_GC_WRAP
+//(GC.with-alloc-scope thunk) => the value of (thunk), called in an allocation scope; (GC.alloc-scope-stats) then reports what it allocated and what escaped.
+Sexpr_t GC_mop3_with_alloc_scope(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  LambRootScope roots(lamb);
+  Sexpr_t call = roots.protect(lamb.cons(lamb.car(sexpr), NIL, env_exec));
+  LambAllocScope scope;
+  return lamb.eval(call, env_exec);
+}
+
+//(GC.alloc-scope-stats [per-loop]) => alist of the allocation scope counters; turns the scope around each loop on or off if given.
+Sexpr_t GC_mop3_alloc_scope_stats(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  if (sexpr != NIL) LambAllocScope::per_loop = lamb.car(sexpr) != HASHF;
+  Sexpr_t res = NIL;
+  res = alist_add(lamb, res, "max-cells", LambAllocScope::max_cells, env_exec);
+  res = alist_add(lamb, res, "escaped", LambAllocScope::total_escaped, env_exec);
+  res = alist_add(lamb, res, "cells", LambAllocScope::total_cells, env_exec);
+  res = alist_add(lamb, res, "scopes", LambAllocScope::scopes, env_exec);
+  res = alist_add(lamb, res, "last-escaped", LambAllocScope::last_escaped, env_exec);
+  res = alist_add(lamb, res, "last-cells", LambAllocScope::last_cells, env_exec);
+  res = alist_add(lamb, res, "per-loop", LambAllocScope::per_loop ? 1 : 0, env_exec);
+  return res;
+}
+#endif
+
+#if LL_GC_WRAP
+//Cons (key v0 v1 ...) onto the alist.
+static Sexpr_t alist_add_list(Lamb &lamb, Sexpr_t alist, const char *key, const uint64_t *v, Int_t n, Sexpr_t env_exec)
+{
+  LambRootScope roots(lamb);
+  roots.protect(alist);
+  Sexpr_t row = NIL;
+  while (n--) {
+    LambRootScope tail(lamb);
+    tail.protect(row);
+    Sexpr_t val = tail.protect((v[n] <= 0x7fffffff) ? lamb.mk_integer((Int_t) v[n], env_exec) : lamb.mk_real((Real_t) v[n], env_exec));
+    row = lamb.cons(val, row, env_exec);
+  }
+  roots.protect(row);
+  row = lamb.cons(lamb.mk_symbol(key, env_exec), row, env_exec);
+  return lamb.cons(row, alist, env_exec);
+}
+
+static Sexpr_t alist_add_histogram(Lamb &lamb, Sexpr_t alist, const char *key, LambHistogram &h, Sexpr_t env_exec)
+{
+  const uint64_t v[] = { h.count, h.percentile(50), h.percentile(99), h.max };
+  return alist_add_list(lamb, alist, key, v, 4, env_exec);
+}
+
+/*
+  (GC.telemetry) => alist of GC telemetry since the last reset:
+  - (allocs . cells allocated), (expands . new cell blocks)
+  - (loop-allocs count p50 p99 max), the cells allocated per loop
+  - (mark count p50 p99 max) and likewise sweep, pass and stop, the GC pauses in us
+  - (yuasa cells free Qm Qs M N), the collector's current Yuasa parameters and the quanta derived from them
+*/
+Sexpr_t GC_mop3_telemetry(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  LambGCTelemetry &t = lambGCTelemetry;
+  Sexpr_t res = NIL;
+  Int_t y[LambGCTelemetry::Nyuasa];
+  if (t.yuasa(y)) {
+    uint64_t v[LambGCTelemetry::Nyuasa];
+    for (Int_t i=0; i<LambGCTelemetry::Nyuasa; i++) v[i] = y[i];
+    res = alist_add_list(lamb, res, "yuasa", v, LambGCTelemetry::Nyuasa, env_exec);
+  }
+  for (Int_t ph=LambGCTelemetry::Nphases-1; ph>=0; ph--) res = alist_add_histogram(lamb, res, LambGCTelemetry::phase_name(ph), t.pause[ph], env_exec);
+  res = alist_add_histogram(lamb, res, "loop-allocs", t.loop_allocs, env_exec);
+  res = alist_add(lamb, res, "expands", t.Nexpand_events, env_exec);
+  res = alist_add(lamb, res, "allocs", t.allocs, env_exec);
+  return res;
+}
+
+Sexpr_t GC_mop3_telemetry_reset(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)	{ lambGCTelemetry.reset();  return OBJ_UNDEF; }
+
+//Cell::type_name() is declared but not built into the library; the feature table has the names.
+
+//(GC.alloc-profile-start [period]) => clear the allocation profile and sample every period allocations (default 1024, 0 stops).
+Sexpr_t GC_mop3_alloc_profile_start(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  lambAllocProfiler.start((sexpr == NIL) ? 1024 : lamb.car(sexpr)->mustbe_Int_t());
+  return OBJ_UNDEF;
+}
+
+Sexpr_t GC_mop3_alloc_profile_stop(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)	{ lambAllocProfiler.stop();  return OBJ_UNDEF; }
+
+/*
+  (GC.alloc-profile [n]) => the n largest allocation sites (default 20), largest first, as lists of
+  (samples estimated-cells type lisp-site native-site)
+*/
+Sexpr_t GC_mop3_alloc_profile(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  Int_t Nmax = (sexpr == NIL) ? 20 : lamb.car(sexpr)->mustbe_Int_t();
+  LambAllocProfiler::Row *rows = new LambAllocProfiler::Row[LambAllocProfiler::Nsites];
+  Int_t Nrows = lambAllocProfiler.report(lamb, rows, LambAllocProfiler::Nsites);
+  if (Nrows > Nmax) Nrows = Nmax;
+
+  Sexpr_t res = NIL;
+  ll_try {
+    for (Int_t i=Nrows-1; i>=0; i--) {
+      LambRootScope roots(lamb);
+      roots.protect(res);
+      Sexpr_t row = NIL;
+      row = roots.protect(lamb.cons(lamb.mk_string(env_exec, "%s", rows[i].native), row, env_exec));
+      row = roots.protect(lamb.cons(lamb.mk_string(env_exec, "%s", rows[i].lisp), row, env_exec));
+      row = roots.protect(lamb.cons(lamb.mk_symbol(cell_type_name(rows[i].typ), env_exec), row, env_exec));
+      const uint64_t counts[] = { (uint64_t) rows[i].samples * lambAllocProfiler.period, rows[i].samples };
+      for (auto c : counts) {
+	Sexpr_t n = (c <= 0x7fffffff) ? lamb.mk_integer((Int_t) c, env_exec) : lamb.mk_real((Real_t) c, env_exec);
+	row = roots.protect(lamb.cons(n, row, env_exec));
+      }
+      res = lamb.cons(row, res, env_exec);
+    }
+  }
+  catch (Sexpr_t err) { delete[] rows;  throw err; }
+  delete[] rows;
+  return res;
+}
+
+//(GC.alloc-profile-dump path) => number of sites written to the file, as tab-separated text.
+Sexpr_t GC_mop3_alloc_profile_dump(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  ME("::GC_mop3_alloc_profile_dump()");
+  Charst_t path = lamb.car(sexpr)->mustbe_any_str_t()->any_str_get_chars();
+  LL_File *f = ll_file_system.open(path, "w");
+  if (!f) throw lamb.mk_error(env_exec, "%s Cannot write %s", me, path);
+
+  LambAllocProfiler::Row *rows = new LambAllocProfiler::Row[LambAllocProfiler::Nsites];
+  Int_t Nrows = lambAllocProfiler.report(lamb, rows, LambAllocProfiler::Nsites);
+  Int_t n = 0;
+  json_printf(f, n, "# period %d, samples %lu, overflow %lu\n# samples\tcells\ttype\tlisp\tnative\n",
+	      lambAllocProfiler.period, (unsigned long) lambAllocProfiler.Nsamples, (unsigned long) lambAllocProfiler.overflow);
+  for (Int_t i=0; i<Nrows; i++)
+    json_printf(f, n, "%lu\t%lu\t%s\t%s\t%s\n", (unsigned long) rows[i].samples, (unsigned long) rows[i].samples * lambAllocProfiler.period,
+		cell_type_name(rows[i].typ), rows[i].lisp, rows[i].native);
+  f->close();
+  delete f;
+  delete[] rows;
+  return lamb.mk_integer(Nrows, env_exec);
+}
+
+//(GC.telemetry-dump path) => bytes of JSON written to the file, with the same content as (GC.telemetry).
+Sexpr_t GC_mop3_telemetry_dump(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  ME("::GC_mop3_telemetry_dump()");
+  Charst_t path = lamb.car(sexpr)->mustbe_any_str_t()->any_str_get_chars();
+  Int_t n = lambGCTelemetry.dump_json(path);
+  if (n < 0) throw lamb.mk_error(env_exec, "%s Cannot write %s", me, path);
+  return lamb.mk_integer(n, env_exec);
+}
+
+//(GC.card-stats) => counters of the card-marked vector barrier.
+Sexpr_t GC_mop3_card_stats(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  Sexpr_t res = NIL;
+  res = alist_add(lamb, res, "shaded", LambCardTable::shaded, env_exec);
+  res = alist_add(lamb, res, "cards-dirtied", LambCardTable::cards_dirtied, env_exec);
+  res = alist_add(lamb, res, "clean-stores", LambCardTable::clean_stores, env_exec);
+  res = alist_add(lamb, res, "stores", LambCardTable::stores, env_exec);
+  return res;
+}
+#endif
+
+#if LL_HEAP_WRAP
+//(GC.slab-stats) => list of (slot-size chunks slots-used slots-total), one per size class.
+Sexpr_t GC_mop3_slab_stats(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  LambRootScope roots(lamb);
+  Sexpr_t res = roots.protect(NIL);
+  for (Int_t c=LambSlab::Nclasses-1; c>=0; c--) {
+    Int_t v[4];
+    LambSlab::stats(c, v[0], v[1], v[2], v[3]);
+    Sexpr_t row = roots.protect(NIL);
+    for (Int_t i=3; i>=0; i--) {
+      Sexpr_t n = roots.protect(lamb.mk_integer(v[i], env_exec));
+      row = roots.protect(lamb.cons(n, row, env_exec));
+    }
+    res = roots.protect(lamb.cons(row, res, env_exec));
+  }
+  return res;
+}
+
+//(GC.heap-trim) => bytes of empty slab chunks released; the system allocator is also asked to return its free pages to the OS.
+Sexpr_t GC_mop3_heap_trim(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)		{ return lamb.mk_integer(LambSlab::trim(), env_exec); }
+
+//(GC.cell-arena) => alist describing the placement of the cell blocks; numa-node is present only when the blocks are bound to a node.
+Sexpr_t GC_mop3_cell_arena(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  Sexpr_t res = NIL;
+  res = alist_add(lamb, res, "region-blocks", LambCellArena::region_blocks(), env_exec);
+  LambCellHandle::bind(lamb);
+  res = alist_add(lamb, res, "blocks", LambCellHandle::blocks(), env_exec);
+  if (LambCellArena::numa_node() >= 0) res = alist_add(lamb, res, "numa-node", LambCellArena::numa_node(), env_exec);
+  LambRootScope roots(lamb);
+  roots.protect(res);
+  Sexpr_t pages = roots.protect(lamb.mk_symbol(LambCellArena::pages_name(LambCellArena::pages()), env_exec));
+  Sexpr_t kv = roots.protect(lamb.cons(lamb.mk_symbol("pages", env_exec), pages, env_exec));
+  return lamb.cons(kv, res, env_exec);
+}
+
+/*
+  (GC.bench [passes]) => alist of mark and sweep throughput over the given number of passes (default 10).
+  The mark phase walks everything reachable from the VM roots; the sweep phase reads the GC state of every cell in every block, in address order, as the collector's sweep does.
+  Run it with different LAMB_CELL_PAGES settings to compare cell placements.
+*/
+Sexpr_t GC_mop3_bench(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  Int_t Npasses = (sexpr == NIL) ? 10 : lamb.car(sexpr)->mustbe_Int_t();
+
+  LambHeapWalker walker(lamb);
+  uint64_t mark_cells = 0;
+  Int_t t0 = micros();
+  for (Int_t pass=0; pass<Npasses; pass++) {
+    walker.marks.clear();
+    walker.add_vm_roots();
+    mark_cells += walker.walk();
+  }
+  Int_t mark_us = micros() - t0;
+
+  uint64_t sweep_cells = 0;
+  Int_t Nfree = 0;
+  t0 = micros();
+  for (Int_t pass=0; pass<Npasses; pass++) {
+    Nfree = 0;
+    for (Int_t b=0; b<LambCellHandle::blocks(); b++) {
+      Sexpr_t c = LambCellHandle::block(b);
+      for (Int_t i=0; i<LambCellArena::cells_per_block; i++) Nfree += (c[i].gc_state() == Cell::gcst_free);
+      sweep_cells += LambCellArena::cells_per_block;
+    }
+  }
+  Int_t sweep_us = micros() - t0;
+
+  Sexpr_t res = NIL;
+  res = alist_add(lamb, res, "free-cells", Nfree, env_exec);
+  res = alist_add(lamb, res, "sweep-us", sweep_us, env_exec);
+  res = alist_add(lamb, res, "sweep-cells", sweep_cells, env_exec);
+  res = alist_add(lamb, res, "mark-us", mark_us, env_exec);
+  res = alist_add(lamb, res, "mark-cells", mark_cells, env_exec);
+  return res;
+}
+#endif
+
+Sexpr_t GC_install_mop3(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  ME("::GC_install_mop3()");
+  ll_try {
+    Sexpr_t env_target = lamb.car(sexpr);
+    lamb.small_ints_install(env_target, env_exec);
+    LambFinalizer::start_worker();
+    LambWeak::install(lamb, env_target, env_exec);
+    LambExternal::bind(lamb);
+
+    static const struct { Lamb::Mop3st_t func;  const char *name; } std_procs[] = {
+      { GC_mop3_live_cells, "GC.live-cells" },
+      { GC_mop3_heap_snapshot, "GC.heap-snapshot" },
+      { GC_mop3_heap_analyze, "GC.heap-analyze" },
+      { GC_mop3_census, "GC.census" },
+      { GC_mop3_pacing, "GC.pacing" },
+      { GC_mop3_pacing_stats, "GC.pacing-stats" },
+      { GC_mop3_pacing_stats_reset, "GC.pacing-stats-reset" },
+      { GC_mop3_deadline, "GC.deadline" },
+      { GC_mop3_finalizer_stats, "GC.finalizer-stats" },
+      { GC_mop3_finalizer_threads, "GC.finalizer-threads" },
+      { GC_mop3_finalizer_bench, "GC.finalizer-bench" },
+      { GC_mop3_mark_bench, "GC.mark-bench" },
+      { GC_mop3_make_weak_box, "GC.make-weak-box" },
+      { GC_mop3_weak_box_p, "GC.weak-box?" },
+      { GC_mop3_weak_box_value, "GC.weak-box-value" },
+      { GC_mop3_make_ephemeron_table, "GC.make-ephemeron-table" },
+      { GC_mop3_ephemeron_table_p, "GC.ephemeron-table?" },
+      { GC_mop3_ephemeron_ref, "GC.ephemeron-ref" },
+      { GC_mop3_ephemeron_set, "GC.ephemeron-set!" },
+      { GC_mop3_ephemeron_delete, "GC.ephemeron-delete!" },
+      { GC_mop3_ephemeron_count, "GC.ephemeron-count" },
+      { GC_mop3_weak_stats, "GC.weak-stats" },
+      { GC_mop3_external_bytes, "GC.external-bytes" },
+      { GC_mop3_external_stats, "GC.external-stats" },
+      { GC_mop3_make_counted_bytevector, "GC.make-counted-bytevector" },
+#if LL_GC_WRAP
+      { GC_mop3_telemetry, "GC.telemetry" },
+      { GC_mop3_telemetry_reset, "GC.telemetry-reset" },
+      { GC_mop3_telemetry_dump, "GC.telemetry-dump" },
+      { GC_mop3_alloc_profile_start, "GC.alloc-profile-start" },
+      { GC_mop3_alloc_profile_stop, "GC.alloc-profile-stop" },
+      { GC_mop3_alloc_profile, "GC.alloc-profile" },
+      { GC_mop3_alloc_profile_dump, "GC.alloc-profile-dump" },
+      { GC_mop3_card_stats, "GC.card-stats" },
+      { GC_mop3_heap_policy, "GC.heap-policy" },
+      { GC_mop3_with_alloc_scope, "GC.with-alloc-scope" },
+      { GC_mop3_alloc_scope_stats, "GC.alloc-scope-stats" },
+#endif
+#if LL_HEAP_WRAP
+      { GC_mop3_slab_stats, "GC.slab-stats" },
+      { GC_mop3_heap_trim, "GC.heap-trim" },
+      { GC_mop3_cell_arena, "GC.cell-arena" },
+      { GC_mop3_bench, "GC.bench" },
+#endif
+      { GC_install_mop3, "GC.install-mop3" }
+    };
+
+    const int Nstd_procs = sizeof(std_procs)/sizeof(std_procs[0]);
+
+    lamb.log("%s defining %d Mops\n", me, Nstd_procs);
+    for (int i=0; i<Nstd_procs; i++) {
+      LambRootScope roots(lamb);
+      Sexpr_t sym  = roots.protect(lamb.mk_symbol(std_procs[i].name, env_exec));
+      Sexpr_t proc = lamb.mk_Mop3_procst_t(std_procs[i].func, env_exec);
+      lamb.dict_bind_bang(env_target, sym, proc, env_exec);
+    }
+
+    return OBJ_UNDEF;
+  }
+  ll_catch();
+}
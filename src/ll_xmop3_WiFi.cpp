@@ -116,9 +116,10 @@ Sexpr_t WiFi_mop3_status(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
   Sexpr_t sx_msg  = lamb.mk_string(env_exec, msg);
   res = lamb.cons(sx_msg, res, env_exec);
 
-  lamb.gc_root_push(res);
+  LambRootScope roots(lamb);
+  roots.protect(res);
   Sexpr_t sx_stat = lamb.mk_integer(stat, env_exec);
-  lamb.gc_root_pop();
+  roots.release();
 
   res = lamb.cons(sx_stat, res, env_exec);
   return res;
@@ -162,10 +163,9 @@ Sexpr_t WiFi_install_mop3(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
     lamb.log("%s defining %d Mops\n", me, Nstd_procs);
     Sexpr_t env_target = lamb.car(sexpr);
     for (int i=0; i<Nstd_procs; i++) {
-      Sexpr_t sym = lamb.mk_symbol(std_procs[i].name, env_exec);
-      lamb.gc_root_push(sym);
+      LambRootScope roots(lamb);
+      Sexpr_t sym = roots.protect(lamb.mk_symbol(std_procs[i].name, env_exec));
       Sexpr_t proc = lamb.mk_Mop3_procst_t(std_procs[i].func, env_exec);
-      lamb.gc_root_pop();
       lamb.dict_bind_bang(env_target, sym, proc, env_exec);
     }
 #endif
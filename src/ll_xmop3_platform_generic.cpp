@@ -26,6 +26,14 @@ Sexpr_t Platform_mop3_random_bytevector(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_e
   return bv;
 }
 
+//(Platform.pin-loop core [rt-priority]) => #t if the loop thread was pinned as requested.
+Sexpr_t Platform_mop3_pin_loop(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
+{
+  Int_t core  = lamb.car(sexpr)->mustbe_Int_t();
+  Int_t prio  = (lamb.cdr(sexpr) == NIL) ? 0 : lamb.cadr(sexpr)->mustbe_Int_t();
+  return lambPlatform.pin_loop(core, prio) ? HASHT : HASHF;
+}
+
 Sexpr_t Platform_mop3_random_integer(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)	{ Int_t r = 0;  lambPlatform.rand((byte *) &r, sizeof(r));  return lamb.mk_integer(r, env_exec); }
 Sexpr_t Platform_mop3_random_real(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec)
 {
@@ -66,6 +74,7 @@ Sexpr_t __lamb_platform_generic_install_mop3(Lamb &lamb, Sexpr_t list_containing
       Platform_mop3_loop_elapsed_ms, "Platform.loop-elapsed-ms",
       Platform_mop3_free_heap, "Platform.free-heap",
       Platform_mop3_free_stack, "Platform.free-stack",
+      Platform_mop3_pin_loop, "Platform.pin-loop",
 
       __lamb_platform_generic_install_mop3, "Platform.install-mop3"
       
@@ -1,4 +1,5 @@
 #include "LambLisp.h"
+#include "ll_gc.h"
 
 /*! @name These are the non-VM operators that are local to this application.
 
@@ -22,6 +23,7 @@
 
 //!@{
 Sexpr_t CommonIO_install_mop3(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec);
+Sexpr_t GC_install_mop3(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec);
 Sexpr_t ESP32_install_mop3(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec);
 Sexpr_t PCA9685_install_mop3(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec);
 Sexpr_t WS2812_install_mop3(Lamb &lamb, Sexpr_t sexpr, Sexpr_t env_exec);
@@ -66,6 +68,7 @@ Sexpr_t install_local_native_operators(Lamb &lamb)
     All the installers have a same signature, of the *Mop3st_t* type.
    */
   const Lamb::Mop3st_t func[] = {
+    GC_install_mop3,
     CommonIO_install_mop3,
 #if LL_CUDA
     Cuda_install_mop3,
@@ -104,8 +107,17 @@ void setup()
 
   LambStdio.begin();
   global_printf("[%lu] %s LambLisp starting, 1st light @%lu ms\n", millis(), me, t_start);
+#if LL_HEAP_WRAP
+  LambCellArena::setup();	//cell placement is fixed by the first block, which the VM allocates as it starts
+#endif
+#if LL_GC_WRAP
+  LambHeapPolicy::setup();
+#endif
   lamb = new Lamb;	//avoid static allocation due to possible lack of terminal at static construct time
   lamb->setup();
+#if LL_GC_WRAP
+  LambHeapPolicy::apply(*lamb);	//pre-expand before setup.scm runs
+#endif
   
   lamb->log("%s Installing local native operators\n", me);
   install_local_native_operators(*lamb);
@@ -120,7 +132,15 @@ void loop()
 {
   ME("::loop()");
   ll_try {
-    lamb->loop();
+    {
+      LambAllocScope scope(LambAllocScope::per_loop);	//count what each loop allocates, and what it leaves in older structures
+      lamb->loop();
+    }
+    LambFinalizer::idle();	//deferred C++ deleters, when there is no worker thread
+    LambWeak::idle(*lamb);	//weak references to cells collected since the last sweep
+#if LL_GC_WRAP
+    LambHeapPolicy::idle(*lamb);	//follow heap growth by the memory manager
+#endif
   }
   
   catch (Sexpr_t err) {	//not ll_catch, this is the last catch